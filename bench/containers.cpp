@@ -0,0 +1,85 @@
+/*
+Times PointChunkMap and LooseChunkMap with 100k objects which all move every frame, and a batch of rectangle and radius queries
+each frame. Build it with:
+	g++ -std=c++17 -O2 -I.. containers.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+Arguments: [object count, default 100000] [frames, default 100]
+*/
+#include "containers.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+typedef std::chrono::steady_clock benchClock;
+
+double millisecondsSince(benchClock::time_point start) {
+	return std::chrono::duration< double, std::milli >(benchClock::now() - start).count();
+}
+
+unsigned int seed = 1;
+
+float random(float range) {
+	seed = (seed * 1103515245) + 12345;
+	return float((seed >> 8) % 65536) * range / 65536;
+}
+
+size_t add(sfte::PointChunkMap< int >& map, int value, sf::Vector2f position) {
+	return map.add(value, position);
+}
+
+size_t add(sfte::LooseChunkMap< int >& map, int value, sf::Vector2f position) {
+	return map.add(value, position, sf::Vector2f(random(16), random(16)));
+}
+
+template< class mapType > void bench(const std::string& name, unsigned int count, unsigned int frames) {
+	// A 4096x4096 world in 64x64 chunks, about 6 objects per chunk
+	const float size = 4096;
+	mapType map(sf::Vector2f(size, size), sf::Vector2f(64, 64));
+	std::vector< size_t > ids(count);
+	std::vector< sf::Vector2f > positions(count), velocities(count);
+	benchClock::time_point start = benchClock::now();
+	for(unsigned int n = 0; n < count; ++n) {
+		positions[n] = sf::Vector2f(random(size), random(size));
+		velocities[n] = sf::Vector2f(random(8) - 4, random(8) - 4);
+		ids[n] = add(map, n, positions[n]);
+	}
+	std::cout << name << ": adding " << count << " objects: " << millisecondsSince(start) << " ms" << std::endl;
+
+	double moveTime = 0,
+		   queryTime = 0;
+	size_t found = 0;
+	std::vector< size_t > out;
+	for(unsigned int frame = 0; frame < frames; ++frame) {
+		start = benchClock::now();
+		for(unsigned int n = 0; n < count; ++n) { // Bounce off the edges of the world
+			positions[n] += velocities[n];
+			if((positions[n].x < 0) || (positions[n].x >= size))
+				velocities[n].x = -velocities[n].x;
+			if((positions[n].y < 0) || (positions[n].y >= size))
+				velocities[n].y = -velocities[n].y;
+			map.move(ids[n], positions[n]);
+		}
+		moveTime += millisecondsSince(start);
+
+		start = benchClock::now();
+		for(int query = 0; query < 100; ++query) {
+			out.clear();
+			sf::Vector2f point(random(size), random(size));
+			map.query(point, point + sf::Vector2f(256, 256), out);
+			found += out.size();
+			out.clear();
+			map.queryRadius(sf::Vector2f(random(size), random(size)), 128, out);
+			found += out.size();
+		}
+		queryTime += millisecondsSince(start);
+	}
+	std::cout << name << ": moving every object: " << (moveTime / frames) << " ms per frame" << std::endl;
+	std::cout << name << ": 100 rectangle and 100 radius queries: " << (queryTime / frames) << " ms per frame (" << (found / frames) << " objects found)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	unsigned int count = (argc > 1) ? std::atoi(argv[1]) : 100000,
+				 frames = (argc > 2) ? std::atoi(argv[2]) : 100;
+	bench< sfte::PointChunkMap< int > >("PointChunkMap", count, frames);
+	bench< sfte::LooseChunkMap< int > >("LooseChunkMap", count, frames);
+	return 0;
+}
\ No newline at end of file
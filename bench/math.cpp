@@ -0,0 +1,63 @@
+/*
+Times nearestEdgeHit on random edge sets of a few sizes. The AVX, SSE or scalar version is picked by the compiler flags, so build it
+once for each to compare them:
+	g++ -std=c++17 -O2 -mavx -I.. math.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+	g++ -std=c++17 -O2 -I.. math.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+	g++ -std=c++17 -O2 -U__SSE2__ -I.. math.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+Arguments: [rays per edge set, default 200000]
+*/
+#include "math.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+typedef std::chrono::steady_clock benchClock;
+
+double millisecondsSince(benchClock::time_point start) {
+	return std::chrono::duration< double, std::milli >(benchClock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	unsigned int rays = (argc > 1) ? std::atoi(argv[1]) : 200000,
+				 seed = 1;
+	auto random = [&seed](float range) {
+		seed = (seed * 1103515245) + 12345;
+		return float((seed >> 16) % 1024) * range / 1024;
+	};
+#if defined(__AVX__)
+	std::cout << "AVX" << std::endl;
+#elif defined(__SSE2__) || defined(_M_X64)
+	std::cout << "SSE" << std::endl;
+#else
+	std::cout << "scalar" << std::endl;
+#endif
+
+	// Rays are generated up front so only nearestEdgeHit is timed
+	std::vector< sf::Vector2f > points(rays), directions(rays);
+	for(unsigned int n = 0; n < rays; ++n) {
+		points[n] = sf::Vector2f(random(64), random(64));
+		directions[n] = sf::Vector2f(random(2) - 1, random(2) - 1);
+	}
+
+	sfte::EdgeArrays edges;
+	for(unsigned int count : { 8, 32, 128, 512 }) {
+		edges.clear();
+		for(unsigned int n = 0; n < count; ++n) {
+			float s = random(64);
+			edges.add(random(1) >= 0.5f, random(64), s, s + random(4));
+		}
+		unsigned int hits = 0;
+		float hit, sum = 0;
+		benchClock::time_point start = benchClock::now();
+		for(unsigned int n = 0; n < rays; ++n) {
+			if(sfte::nearestEdgeHit(points[n], directions[n], 0, edges, hit)) {
+				++hits;
+				sum += hit;
+			}
+		}
+		double ms = millisecondsSince(start);
+		// The hit count and sum keep the calls from being optimised away
+		std::cout << count << " edges: " << ms << " ms for " << rays << " rays, " << (ms * 1000000 / rays) << " ns per ray (" << hits << " hits, sum " << sum << ")" << std::endl;
+	}
+	return 0;
+}
\ No newline at end of file
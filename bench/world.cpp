@@ -0,0 +1,63 @@
+/*
+Times World construction, genBitmask, genOccluderMap and a full-screen render on a big random map. Build it at two commits to
+compare them, e.g. before and after a change to the chunk storage:
+	g++ -std=c++17 -O2 -I.. world.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+Arguments: [map size in tiles, default 2048]
+*/
+#include "light.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+
+typedef std::chrono::steady_clock benchClock;
+
+double millisecondsSince(benchClock::time_point start) {
+	return std::chrono::duration< double, std::milli >(benchClock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	unsigned int size = (argc > 1) ? std::atoi(argv[1]) : 2048,
+				 layers = 8;
+	std::vector< sfte::TileProperty > properties;
+	properties.push_back(sfte::TileProperty(sf::Vector2f(0, 0), sf::Vector2f(16, 16), false));
+	properties.push_back(sfte::TileProperty(sf::Vector2f(16, 0), sf::Vector2f(16, 16), true, sfte::visibilityOpaque, 1));
+	properties.push_back(sfte::TileProperty(sf::Vector2f(32, 0), sf::Vector2f(16, 16), true, sfte::visibilityTransparent, 2));
+	sf::RenderTexture target;
+	target.create(1920, 1080);
+	sf::Texture tilemap;
+
+	benchClock::time_point start = benchClock::now();
+	sfte::World< std::uint8_t > world(&properties, sf::Vector3u(size, size, layers), sf::Vector2u(8, 8), &tilemap, std::vector< sf::Color >(layers, sf::Color::White), 0, &target);
+	std::cout << "construction (" << size << "x" << size << "x" << layers << "): " << millisecondsSince(start) << " ms" << std::endl;
+
+	// Random ground, and one transparent tile higher up in every column
+	unsigned int seed = 1;
+	world.beginEdit();
+	for(unsigned int x = 0; x < size; ++x) {
+		for(unsigned int y = 0; y < size; ++y) {
+			seed = (seed * 1103515245) + 12345;
+			world.tile(sf::Vector3u(x, y, 0), (seed >> 16) % 3);
+			world.tile(sf::Vector3u(x, y, 1 + ((seed >> 8) % (layers - 1))), 2);
+		}
+	}
+	world.commitEdit();
+
+	start = benchClock::now();
+	world.genBitmask();
+	std::cout << "genBitmask: " << millisecondsSince(start) << " ms" << std::endl;
+	start = benchClock::now();
+	world.genOccluderMap();
+	std::cout << "genOccluderMap: " << millisecondsSince(start) << " ms" << std::endl;
+
+	// 1920x1080 of 8 pixel tiles. The geometry is rebuilt every time, and the best of a few runs is kept.
+	double best = 1e9;
+	for(int run = 0; run < 5; ++run) {
+		world.redraw();
+		start = benchClock::now();
+		world.render(sf::Vector2f(run, 0), sf::Vector2f(run + 240, 135));
+		best = std::min(best, millisecondsSince(start));
+	}
+	std::cout << "full-screen render (240x135 tiles, geometry rebuilt): " << best << " ms" << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -3,17 +3,56 @@
 
 #include <stdexcept>
 #include <deque>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <type_traits>
 #include "core.hpp"
 
 namespace sfte {
-	template < class objectType, typename IDType = size_t > class Sponge { // A container for random access which fills holes that are created on object removal
-		std::vector < objectType > vec;
-		std::deque < IDType > removed;
+	/*
+	A container for random access which fills holes that are created on object removal. IDs hold the slot of the object in their
+	low 3/4 bits and the generation of the slot in the rest. The generation is bumped when the object is removed, so a stale ID is
+	caught instead of reaching whatever reused its slot. Slots whose generation would wrap are retired instead of reused. Objects
+	are kept packed in a dense array, which begin and end iterate without holes. Removing an object moves the last one into its
+	place, so references and iterators to objects don't survive del.
+	*/
+	template < class objectType, typename IDType = size_t > class Sponge {
+		static_assert(std::is_integral< IDType >::value && std::is_unsigned< IDType >::value, "Sponge IDs must be an unsigned integer type");
+
+		struct Slot {
+			size_t index;			// Of the object in dense while the slot is used, of the next free slot while it isn't.
+			IDType generation;
+			bool used;
+		};
+
+		std::vector < objectType > dense;	// The objects, without holes.
+		std::vector < IDType > denseIDs;	// ID of each object of dense, to find its slot when another object is moved into its place.
+		std::vector < Slot > slots;
+		size_t freeSlot = noSlot;			// Head of the free list.
+
+		static const size_t noSlot = size_t(-1);
+		Slot& checkedSlot(IDType i, const char* function); // Throws for IDs which don't refer to an object
 	public:
+		static const unsigned int indexBits = (sizeof(IDType) * 8 * 3) / 4;
+		static const IDType indexMask = IDType((IDType(1) << indexBits) - 1),
+							maxGeneration = IDType(IDType(~IDType(0)) >> indexBits);
 
 		objectType& operator[](IDType i);
 		IDType add(objectType val);
 		void del(IDType i);
+		bool contains(IDType i) const;	// Whether i refers to an object which wasn't removed
+		size_t size() const;
+
+		// Dense iteration. The n-th object has the ID getID(n).
+		typename std::vector< objectType >::iterator begin();
+		typename std::vector< objectType >::iterator end();
+		IDType getID(size_t n) const;
+
+		static size_t slotOf(IDType i); // For arrays kept beside the Sponge. A slot is reused by a later object once its object is removed.
+		size_t getSlotCount() const;	// Every slot is below this
 	};
 
 	/*	sfte::Sponge implementation. Has to be in the header for the same reason in world.hpp
@@ -23,54 +62,681 @@ namespace sfte {
 			;
 		}
 	*/
+		template< class objectType, typename IDType > typename Sponge< objectType, IDType >::Slot& Sponge< objectType, IDType >::checkedSlot(IDType i, const char* function) {
+			size_t slot = slotOf(i);
+			if(slot >= slots.size())
+				throw std::range_error(std::string("Attempt to access non-existent member of Sponge in ") + function + "! i = " + std::to_string(i) + ";slots.size() = " + std::to_string(slots.size()));
+			if(!slots[slot].used || (slots[slot].generation != IDType(i >> indexBits)))
+				throw std::runtime_error(std::string("Cannot access a Sponge's hole (deleted member) in ") + function + "! i = " + std::to_string(i));
+			return slots[slot];
+		}
+
 		template< class objectType, typename IDType > objectType& Sponge< objectType, IDType >::operator[](IDType i) {
-			for(IDType n : removed) {
-				if(n == i)
-					throw std::runtime_error("Cannot access a Sponge's hole (deleted member)! i = " + std::to_string(i));
+			return dense[checkedSlot(i, "Sponge::operator[]").index];
+		}
+
+		template< class objectType, typename IDType > IDType Sponge< objectType, IDType >::add(objectType val) {
+			size_t slot = freeSlot;
+			if(slot != noSlot)
+				freeSlot = slots[slot].index;
+			else {
+				if(slots.size() > indexMask)
+					throw std::length_error("Sponge is out of IDs! slots.size() = " + std::to_string(slots.size()));
+				slot = slots.size();
+				slots.push_back(Slot{0, 0, false});
 			}
 
-			return vec[i];
+			IDType i = IDType(slot | (size_t(slots[slot].generation) << indexBits));
+			dense.push_back(std::move(val));
+			denseIDs.push_back(i);
+			slots[slot].index = dense.size() - 1;
+			slots[slot].used = true;
+			return i;
 		}
 
-		template< class objectType, typename IDType > IDType Sponge< objectType, IDType >::add(objectType val) {
-			if(removed.size() > 0) {
-				IDType i = removed.front();
-				removed.pop_front();
-				vec[i] = val;
-				return i;
+		template< class objectType, typename IDType > void Sponge< objectType, IDType >::del(IDType i) {
+			Slot& slot = checkedSlot(i, "Sponge::del");
+
+			// Fill the hole in dense with its last object
+			size_t index = slot.index;
+			if(index != dense.size() - 1) {
+				dense[index] = std::move(dense.back());
+				denseIDs[index] = denseIDs.back();
+				slots[slotOf(denseIDs[index])].index = index;
+			}
+			dense.pop_back();
+			denseIDs.pop_back();
+
+			slot.used = false;
+			if(slot.generation == maxGeneration)
+				return; // Retired, as its next ID would be one that was already handed out
+			++slot.generation;
+			slot.index = freeSlot;
+			freeSlot = slotOf(i);
+		}
+
+		template< class objectType, typename IDType > bool Sponge< objectType, IDType >::contains(IDType i) const {
+			size_t slot = slotOf(i);
+			return (slot < slots.size()) && slots[slot].used && (slots[slot].generation == IDType(i >> indexBits));
+		}
+
+		template< class objectType, typename IDType > size_t Sponge< objectType, IDType >::size() const {
+			return dense.size();
+		}
+
+		template< class objectType, typename IDType > typename std::vector< objectType >::iterator Sponge< objectType, IDType >::begin() {
+			return dense.begin();
+		}
+
+		template< class objectType, typename IDType > typename std::vector< objectType >::iterator Sponge< objectType, IDType >::end() {
+			return dense.end();
+		}
+
+		template< class objectType, typename IDType > IDType Sponge< objectType, IDType >::getID(size_t n) const {
+			return denseIDs[n];
+		}
+
+		template< class objectType, typename IDType > size_t Sponge< objectType, IDType >::slotOf(IDType i) {
+			return size_t(i & indexMask);
+		}
+
+		template< class objectType, typename IDType > size_t Sponge< objectType, IDType >::getSlotCount() const {
+			return slots.size();
+		}
+
+	template < typename valueType > class PaletteArray { // A fixed size array stored as bit-packed indices into a palette of the distinct values in it
+		std::vector < valueType > palette;							// Values in use. Entries with a count of 0 are free.
+		std::vector < size_t > counts;								// Number of elements using each palette entry.
+		std::vector < size_t > freeEntries;							// Palette entries with a count of 0, reused before the palette grows.
+		std::unordered_map < valueType, size_t > paletteLookup;		// Value to palette entry. Only kept for palettes too big to search.
+		std::vector < std::uint64_t > words;						// The packed indices. An index never straddles two words.
+		size_t count = 0;											// Number of elements.
+		unsigned int bits = 0,										// Width of an index: 0, 1, 2, 4, 8, 16 or 32. 0 means every element has the same value.
+					 perWordShift = 0;								// log2 of the number of indices per word.
+		std::uint64_t indexMask = 0;
+
+		inline void setIndex(size_t i, size_t entry);
+		size_t findEntry(valueType value);	// palette.size() if the value isn't in the palette
+		size_t addEntry(valueType value);
+		void pack(const std::vector < size_t >& indices, unsigned int newBits);
+		template< unsigned int wordBits > void unpackWords(const std::uint64_t* from, size_t wordCount, valueType* out) const; // unpack for whole words of a known width
+	public:
+		static const size_t searchLimit = 16; // Palettes up to this size are searched instead of using paletteLookup.
+
+		inline valueType operator[](size_t i) const; // Unchecked, like std::vector. i < size() means the palette isn't empty, even after clear.
+		inline size_t getIndex(size_t i) const; // Palette entry of element i, for passes which translate the palette once instead of every element
+		inline void set(size_t i, valueType value);
+		void assign(size_t newCount, valueType value);
+		void assign(const valueType* values, size_t newCount);
+		void unpack(size_t begin, size_t n, valueType* out) const; // Read n elements at once. n may be 0, also on a cleared array.
+		void clear(); // Remove every element and free the memory
+
+		size_t size() const;
+		size_t getPaletteSize() const; // Number of distinct values
+		const std::vector < valueType >& getPalette() const; // Every entry, including free ones
+		unsigned int getBitsPerIndex() const;
+		size_t memoryUsage() const; // Bytes allocated
+	};
+
+	/*	sfte::PaletteArray implementation. Has to be in the header for the same reason in world.hpp */
+		template< typename valueType > inline size_t PaletteArray< valueType >::getIndex(size_t i) const {
+			if(bits == 0)
+				return 0;
+			return (words[i >> perWordShift] >> ((i & ((size_t(1) << perWordShift) - 1)) * bits)) & indexMask;
+		}
+
+		template< typename valueType > inline void PaletteArray< valueType >::setIndex(size_t i, size_t entry) {
+			std::uint64_t& word = words[i >> perWordShift];
+			unsigned int shift = (i & ((size_t(1) << perWordShift) - 1)) * bits;
+			word = (word & ~(indexMask << shift)) | (std::uint64_t(entry) << shift);
+		}
+
+		template< typename valueType > size_t PaletteArray< valueType >::findEntry(valueType value) {
+			if(!paletteLookup.empty()) {
+				typename std::unordered_map< valueType, size_t >::const_iterator found = paletteLookup.find(value);
+				return (found == paletteLookup.end()) ? palette.size() : found->second;
+			}
+			for(size_t entry = 0; entry < palette.size(); ++entry) {
+				if((palette[entry] == value) && (counts[entry] > 0))
+					return entry;
+			}
+			return palette.size();
+		}
+
+		template< typename valueType > size_t PaletteArray< valueType >::addEntry(valueType value) {
+			size_t entry;
+			if(!freeEntries.empty()) {
+				entry = freeEntries.back();
+				freeEntries.pop_back();
+				palette[entry] = value;
 			}
 			else {
-				vec.push_back(val);
-				return vec.size() - 1;
+				entry = palette.size();
+				palette.push_back(value);
+				counts.push_back(0);
+				if(palette.size() > (size_t(1) << bits)) { // Widen the indices. Doesn't happen often, as the width doubles every time.
+					std::vector< size_t > indices(count);
+					for(size_t i = 0; i < count; ++i)
+						indices[i] = getIndex(i);
+					pack(indices, (bits == 0) ? 1 : bits * 2);
+				}
 			}
+
+			if(!paletteLookup.empty())
+				paletteLookup[value] = entry;
+			else if(palette.size() > searchLimit) {
+				for(size_t n = 0; n < palette.size(); ++n) {
+					if((counts[n] > 0) || (n == entry))
+						paletteLookup[palette[n]] = n;
+				}
+			}
+			return entry;
 		}
 
-		template< class objectType, typename IDType > void Sponge< objectType, IDType >::del(IDType i) {
-			if(i < 0)
-				throw std::invalid_argument("Iterator i is negative in Sponge::del! i = " + i);
+		template< typename valueType > void PaletteArray< valueType >::pack(const std::vector< size_t >& indices, unsigned int newBits) {
+			bits = newBits;
+			if(bits == 0) {
+				std::vector< std::uint64_t >().swap(words);
+				return;
+			}
+			perWordShift = (bits == 1) ? 6 : (bits == 2) ? 5 : (bits == 4) ? 4 : (bits == 8) ? 3 : (bits == 16) ? 2 : 1;
+			indexMask = (bits == 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << bits) - 1);
+			words.assign((count + (size_t(1) << perWordShift) - 1) >> perWordShift, 0);
+			for(size_t i = 0; i < count; ++i)
+				setIndex(i, indices[i]);
+		}
+
+		template< typename valueType > inline valueType PaletteArray< valueType >::operator[](size_t i) const {
+			return palette[getIndex(i)];
+		}
+
+		template< typename valueType > inline void PaletteArray< valueType >::set(size_t i, valueType value) {
+			if(i >= count)
+				throw std::out_of_range("PaletteArray index out of range! i = " + std::to_string(i));
+			size_t old = getIndex(i);
+			if(palette[old] == value)
+				return;
+
+			size_t entry = findEntry(value);
+			if(entry == palette.size()) {
+				if(counts[old] == 1) { // The element was the last user of its entry, so the entry can just take the new value.
+					if(!paletteLookup.empty()) {
+						paletteLookup.erase(palette[old]);
+						paletteLookup[value] = old;
+					}
+					palette[old] = value;
+					return;
+				}
+				entry = addEntry(value);
+			}
+
+			if(--counts[old] == 0) {
+				freeEntries.push_back(old);
+				if(!paletteLookup.empty())
+					paletteLookup.erase(palette[old]);
+			}
+			++counts[entry];
+			setIndex(i, entry);
+		}
 
-			if(i >= vec.size())
-				throw std::range_error("Attempt to remove non-existent member of Sponge! i = " + std::to_string(i) + ";vec.size() = " + std::to_string(vec.size()));
+		template< typename valueType > void PaletteArray< valueType >::assign(size_t newCount, valueType value) {
+			clear();
+			count = newCount;
+			palette.push_back(value);
+			counts.push_back(count);
+		}
+
+		template< typename valueType > void PaletteArray< valueType >::assign(const valueType* values, size_t newCount) {
+			clear();
+			count = newCount;
+			if(count == 0)
+				return;
+
+			// Build the palette first, so the indices are packed once at their final width
+			std::vector< size_t > indices(count);
+			for(size_t i = 0; i < count; ++i) {
+				size_t entry = ((i > 0) && (values[i] == values[i - 1])) ? indices[i - 1] : findEntry(values[i]); // Runs are common in tile data
+				if(entry == palette.size()) {
+					palette.push_back(values[i]);
+					counts.push_back(0);
+					if(!paletteLookup.empty())
+						paletteLookup[values[i]] = entry;
+					else if(palette.size() > searchLimit) {
+						for(size_t n = 0; n < palette.size(); ++n)
+							paletteLookup[palette[n]] = n;
+					}
+				}
+				++counts[entry];
+				indices[i] = entry;
+			}
+
+			unsigned int newBits = 0;
+			while((size_t(1) << newBits) < palette.size())
+				newBits = (newBits == 0) ? 1 : newBits * 2;
+			pack(indices, newBits);
+		}
+
+		template< typename valueType > void PaletteArray< valueType >::unpack(size_t begin, size_t n, valueType* out) const {
+			if((n == 0) || palette.empty()) // Nothing to read, and no palette[0] after clear or before assign
+				return;
+			if(bits == 0) {
+				std::fill(out, out + n, palette[0]);
+				return;
+			}
+			// A word at a time, shifting the next index down instead of locating every index on its own.
+			// Whole words go through unpackWords, where the width is a constant and the loop can be unrolled.
+			// Members are copied to locals, as stores through out may alias them when valueType is a char type.
+			const valueType* values = palette.data();
+			const std::uint64_t* packed = words.data();
+			std::uint64_t mask = indexMask;
+			unsigned int width = bits,
+						 shift = perWordShift;
+			size_t i = begin,
+				   end = begin + n,
+				   perWordMask = (size_t(1) << shift) - 1;
+			while(i < end) {
+				size_t stop = std::min(end, (i | perWordMask) + 1);
+				if(((i & perWordMask) == 0) && (stop - i == perWordMask + 1)) {
+					size_t wholeWords = (end - i) >> shift;
+					const std::uint64_t* from = packed + (i >> shift);
+					switch(width) {
+					case 1: unpackWords< 1 >(from, wholeWords, out); break;
+					case 2: unpackWords< 2 >(from, wholeWords, out); break;
+					case 4: unpackWords< 4 >(from, wholeWords, out); break;
+					case 8: unpackWords< 8 >(from, wholeWords, out); break;
+					case 16: unpackWords< 16 >(from, wholeWords, out); break;
+					default: unpackWords< 32 >(from, wholeWords, out); break;
+					}
+					i += wholeWords << shift;
+					out += wholeWords << shift;
+					continue;
+				}
+				std::uint64_t word = packed[i >> shift];
+				for(unsigned int bit = (i & perWordMask) * width; i < stop; ++i, bit += width)
+					*out++ = values[(word >> bit) & mask];
+			}
+		}
 
-			for(IDType n = 0; n < removed.size(); ++n) {
-				if(removed[n] == i)
-					throw std::runtime_error("Cannot access a Sponge's hole (deleted member)! i = " + std::to_string(i));
+		template< typename valueType > template< unsigned int wordBits > void PaletteArray< valueType >::unpackWords(const std::uint64_t* from, size_t wordCount, valueType* out) const {
+			const valueType* values = palette.data();
+			for(size_t n = 0; n < wordCount; ++n) {
+				std::uint64_t word = from[n];
+				for(unsigned int shift = 0; shift < 64; shift += wordBits, ++out)
+					*out = values[(word >> shift) & ((std::uint64_t(1) << wordBits) - 1)];
 			}
+		}
+
+		template< typename valueType > void PaletteArray< valueType >::clear() {
+			std::vector< valueType >().swap(palette);
+			std::vector< size_t >().swap(counts);
+			std::vector< size_t >().swap(freeEntries);
+			std::unordered_map< valueType, size_t >().swap(paletteLookup);
+			std::vector< std::uint64_t >().swap(words);
+			count = 0;
+			bits = 0;
+		}
+
+		template< typename valueType > size_t PaletteArray< valueType >::size() const {
+			return count;
+		}
+
+		template< typename valueType > size_t PaletteArray< valueType >::getPaletteSize() const {
+			return palette.size() - freeEntries.size();
+		}
+
+		template< typename valueType > const std::vector< valueType >& PaletteArray< valueType >::getPalette() const {
+			return palette;
+		}
+
+		template< typename valueType > unsigned int PaletteArray< valueType >::getBitsPerIndex() const {
+			return bits;
+		}
 
-			removed.push_back(i);
+		template< typename valueType > size_t PaletteArray< valueType >::memoryUsage() const {
+			return (palette.capacity() * sizeof(valueType)) + ((counts.capacity() + freeEntries.capacity()) * sizeof(size_t)) + (words.capacity() * sizeof(std::uint64_t)) +
+				   (paletteLookup.size() * (sizeof(valueType) + sizeof(size_t) + sizeof(void*))) + (paletteLookup.bucket_count() * sizeof(void*)); // Rough size of the hash map nodes and buckets
 		}
 
 	template < class objectType, typename IDType = size_t > class PointChunkMap { // A container for holding objects of point size in chunks of defined size
-		std::vector < std::vector < std::vector < objectType* > > > chunks;	// The chunks of the chunkmap. Only stores the pointers to the objects for easy movement.
-		Sponge < objectType, IDType > objectStack;							// Where the objects are actually held.
+		struct Placement {
+			sf::Vector2f position;
+			sf::Vector2u chunk;	// Chunk the object is listed in
+			size_t slot;		// and where in the chunk's list.
+		};
+
+		std::vector < std::vector < std::vector < IDType > > > chunks;	// The chunks of the chunkmap. Stores the IDs of the objects, as pointers would break when objectStack grows.
+		Sponge < objectType, IDType > objectStack;						// Where the objects are actually held.
+		std::vector < Placement > placements;							// Where each object is. Indexed by the slot of its ID in objectStack.
 		sf::Vector2f chunkSize,
 					 mapSize;
+
+		sf::Vector2u chunkAt(sf::Vector2f position); // Positions outside of the map belong to the nearest chunk on its edge
+		void list(IDType objectID, sf::Vector2f position);
+		void unlist(IDType objectID);
+	public:
+		IDType add(objectType object, sf::Vector2f position);
+		void move(IDType objectID, sf::Vector2f position);
+		void remove(IDType objectID);
+		objectType& operator[](IDType objectID);
+		sf::Vector2f getPosition(IDType objectID);
+		size_t size();
+		bool contains(IDType objectID);
+		static size_t slotOf(IDType objectID); // Same as Sponge::slotOf
+
+		// Append the IDs of the objects inside the rectangle (edges included) to out. Only the chunks the rectangle touches are visited.
+		void query(sf::Vector2f tlPoint, sf::Vector2f brPoint, std::vector < IDType >& out);
+		void queryRadius(sf::Vector2f centre, float radius, std::vector < IDType >& out); // Same, inside the circle
+
+		PointChunkMap(sf::Vector2f chunkmapSize, sf::Vector2f chunkmapChunkSize);
+	};
+
+	/*	sfte::PointChunkMap implementation. Has to be in the header for the same reason in world.hpp */
+		template< class objectType, typename IDType > sf::Vector2u PointChunkMap< objectType, IDType >::chunkAt(sf::Vector2f position) {
+			long x = long(std::floor(position.x / chunkSize.x)),
+				 y = long(std::floor(position.y / chunkSize.y));
+			return sf::Vector2u(std::min(size_t(std::max(x, 0L)), chunks.size() - 1), std::min(size_t(std::max(y, 0L)), chunks[0].size() - 1));
+		}
+
+		template< class objectType, typename IDType > void PointChunkMap< objectType, IDType >::list(IDType objectID, sf::Vector2f position) {
+			Placement& placement = placements[slotOf(objectID)];
+			placement.position = position;
+			placement.chunk = chunkAt(position);
+			std::vector< IDType >& chunk = chunks[placement.chunk.x][placement.chunk.y];
+			placement.slot = chunk.size();
+			chunk.push_back(objectID);
+		}
+
+		template< class objectType, typename IDType > void PointChunkMap< objectType, IDType >::unlist(IDType objectID) {
+			// Swap with the last object of the chunk, so removal doesn't shift the rest
+			const Placement& placement = placements[slotOf(objectID)];
+			std::vector< IDType >& chunk = chunks[placement.chunk.x][placement.chunk.y];
+			IDType last = chunk.back();
+			chunk[placement.slot] = last;
+			placements[slotOf(last)].slot = placement.slot;
+			chunk.pop_back();
+		}
+
+		template< class objectType, typename IDType > IDType PointChunkMap< objectType, IDType >::add(objectType object, sf::Vector2f position) {
+			IDType objectID = objectStack.add(object);
+			if(slotOf(objectID) >= placements.size())
+				placements.resize(slotOf(objectID) + 1);
+			list(objectID, position);
+			return objectID;
+		}
+
+		template< class objectType, typename IDType > void PointChunkMap< objectType, IDType >::move(IDType objectID, sf::Vector2f position) {
+			objectStack[objectID]; // Throws for removed objects
+			Placement& placement = placements[slotOf(objectID)];
+			if(chunkAt(position) == placement.chunk) { // Most moves stay inside the chunk
+				placement.position = position;
+				return;
+			}
+			unlist(objectID);
+			list(objectID, position);
+		}
+
+		template< class objectType, typename IDType > void PointChunkMap< objectType, IDType >::remove(IDType objectID) {
+			objectStack.del(objectID);
+			unlist(objectID);
+		}
+
+		template< class objectType, typename IDType > objectType& PointChunkMap< objectType, IDType >::operator[](IDType objectID) {
+			return objectStack[objectID];
+		}
+
+		template< class objectType, typename IDType > sf::Vector2f PointChunkMap< objectType, IDType >::getPosition(IDType objectID) {
+			objectStack[objectID]; // Same as in move
+			return placements[slotOf(objectID)].position;
+		}
+
+		template< class objectType, typename IDType > size_t PointChunkMap< objectType, IDType >::size() {
+			return objectStack.size();
+		}
+
+		template< class objectType, typename IDType > bool PointChunkMap< objectType, IDType >::contains(IDType objectID) {
+			return objectStack.contains(objectID);
+		}
+
+		template< class objectType, typename IDType > size_t PointChunkMap< objectType, IDType >::slotOf(IDType objectID) {
+			return Sponge< objectType, IDType >::slotOf(objectID);
+		}
+
+		template< class objectType, typename IDType > void PointChunkMap< objectType, IDType >::query(sf::Vector2f tlPoint, sf::Vector2f brPoint, std::vector< IDType >& out) {
+			if((tlPoint.x > brPoint.x) || (tlPoint.y > brPoint.y))
+				return;
+			sf::Vector2u tlChunk(chunkAt(tlPoint)),
+						 brChunk(chunkAt(brPoint));
+			for(size_t x = tlChunk.x; x <= brChunk.x; ++x) {
+				for(size_t y = tlChunk.y; y <= brChunk.y; ++y) {
+					for(IDType objectID : chunks[x][y]) {
+						sf::Vector2f position(placements[slotOf(objectID)].position);
+						if((position.x >= tlPoint.x) && (position.x <= brPoint.x) && (position.y >= tlPoint.y) && (position.y <= brPoint.y))
+							out.push_back(objectID);
+					}
+				}
+			}
+		}
+
+		template< class objectType, typename IDType > void PointChunkMap< objectType, IDType >::queryRadius(sf::Vector2f centre, float radius, std::vector< IDType >& out) {
+			size_t first = out.size();
+			query(sf::Vector2f(centre.x - radius, centre.y - radius), sf::Vector2f(centre.x + radius, centre.y + radius), out);
+			size_t kept = first;
+			for(size_t n = first; n < out.size(); ++n) {
+				sf::Vector2f position(placements[slotOf(out[n])].position);
+				if(((position.x - centre.x) * (position.x - centre.x)) + ((position.y - centre.y) * (position.y - centre.y)) <= radius * radius)
+					out[kept++] = out[n];
+			}
+			out.resize(kept);
+		}
+
+		template< class objectType, typename IDType > PointChunkMap< objectType, IDType >::PointChunkMap(sf::Vector2f chunkmapSize, sf::Vector2f chunkmapChunkSize) :
+			chunkSize(chunkmapChunkSize),
+			mapSize(chunkmapSize)
+		{
+			if((chunkSize.x <= 0) || (chunkSize.y <= 0))
+				throw std::invalid_argument("PointChunkMap chunk size must be positive! chunkSize = " + std::to_string(chunkSize.x) + "x" + std::to_string(chunkSize.y));
+			size_t chunksX = std::max(size_t(std::ceil(mapSize.x / chunkSize.x)), size_t(1)),
+				   chunksY = std::max(size_t(std::ceil(mapSize.y / chunkSize.y)), size_t(1));
+			chunks.assign(chunksX, std::vector< std::vector< IDType > >(chunksY));
+		}
+
+	/*
+	A PointChunkMap for objects with an extent, like lights with a radius. Objects are boxes given by their centre and half size,
+	and are listed in the chunk of their centre only, so moving or growing one never lists it twice. Each chunk remembers the
+	largest half size listed in it, and queries grow the chunk by it to tell whether any of its objects could reach the rectangle.
+	*/
+	template < class objectType, typename IDType = size_t > class LooseChunkMap {
+		struct Placement {
+			sf::Vector2f position,	// Centre of the box
+						 halfSize;
+			sf::Vector2u chunk;		// Chunk the object is listed in
+			size_t slot;			// and where in the chunk's list.
+		};
+
+		struct Chunk {
+			std::vector < IDType > objects;
+			sf::Vector2f reach;		// Largest half size of the objects listed here since the chunk was last empty.
+		};
+
+		std::vector < std::vector < Chunk > > chunks;
+		Sponge < objectType, IDType > objectStack;	// Where the objects are actually held.
+		std::vector < Placement > placements;		// Indexed by the slot of the object's ID in objectStack.
+		sf::Vector2f chunkSize,
+					 mapSize,
+					 maxReach;						// Largest reach of any chunk. Only grows.
+
+		sf::Vector2u chunkAt(sf::Vector2f position); // Positions outside of the map belong to the nearest chunk on its edge
+		void list(IDType objectID);
+		void unlist(IDType objectID);
 	public:
-		
-		void move(size_t objectID, sf::Vector2f position);
-		size_t add(objectType object, sf::Vector2f position);
-		void remove(size_t objectID);
+		IDType add(objectType object, sf::Vector2f position, sf::Vector2f halfSize);
+		void move(IDType objectID, sf::Vector2f position);
+		void resize(IDType objectID, sf::Vector2f halfSize);
+		void remove(IDType objectID);
+		objectType& operator[](IDType objectID);
+		sf::Vector2f getPosition(IDType objectID);
+		sf::Vector2f getHalfSize(IDType objectID);
+		size_t size();
+		bool contains(IDType objectID);
+		static size_t slotOf(IDType objectID); // Same as Sponge::slotOf
+
+		// Append the IDs of the objects whose box overlaps the rectangle (edges included) to out
+		void query(sf::Vector2f tlPoint, sf::Vector2f brPoint, std::vector < IDType >& out);
+		void queryRadius(sf::Vector2f centre, float radius, std::vector < IDType >& out); // Same, for boxes which overlap the circle
+
+		LooseChunkMap(sf::Vector2f chunkmapSize, sf::Vector2f chunkmapChunkSize);
 	};
+
+	/*	sfte::LooseChunkMap implementation. Has to be in the header for the same reason in world.hpp */
+		template< class objectType, typename IDType > sf::Vector2u LooseChunkMap< objectType, IDType >::chunkAt(sf::Vector2f position) {
+			long x = long(std::floor(position.x / chunkSize.x)),
+				 y = long(std::floor(position.y / chunkSize.y));
+			return sf::Vector2u(std::min(size_t(std::max(x, 0L)), chunks.size() - 1), std::min(size_t(std::max(y, 0L)), chunks[0].size() - 1));
+		}
+
+		template< class objectType, typename IDType > void LooseChunkMap< objectType, IDType >::list(IDType objectID) {
+			Placement& placement = placements[slotOf(objectID)];
+			placement.chunk = chunkAt(placement.position);
+			Chunk& chunk = chunks[placement.chunk.x][placement.chunk.y];
+			placement.slot = chunk.objects.size();
+			chunk.objects.push_back(objectID);
+			chunk.reach.x = std::max(chunk.reach.x, placement.halfSize.x);
+			chunk.reach.y = std::max(chunk.reach.y, placement.halfSize.y);
+			maxReach.x = std::max(maxReach.x, chunk.reach.x);
+			maxReach.y = std::max(maxReach.y, chunk.reach.y);
+		}
+
+		template< class objectType, typename IDType > void LooseChunkMap< objectType, IDType >::unlist(IDType objectID) {
+			// Swap with the last object of the chunk, so removal doesn't shift the rest
+			const Placement& placement = placements[slotOf(objectID)];
+			Chunk& chunk = chunks[placement.chunk.x][placement.chunk.y];
+			IDType last = chunk.objects.back();
+			chunk.objects[placement.slot] = last;
+			placements[slotOf(last)].slot = placement.slot;
+			chunk.objects.pop_back();
+			if(chunk.objects.empty())
+				chunk.reach = sf::Vector2f(0, 0);
+		}
+
+		template< class objectType, typename IDType > IDType LooseChunkMap< objectType, IDType >::add(objectType object, sf::Vector2f position, sf::Vector2f halfSize) {
+			if((halfSize.x < 0) || (halfSize.y < 0))
+				throw std::invalid_argument("LooseChunkMap half size can't be negative! halfSize = " + std::to_string(halfSize.x) + "x" + std::to_string(halfSize.y));
+			IDType objectID = objectStack.add(object);
+			if(slotOf(objectID) >= placements.size())
+				placements.resize(slotOf(objectID) + 1);
+			placements[slotOf(objectID)].position = position;
+			placements[slotOf(objectID)].halfSize = halfSize;
+			list(objectID);
+			return objectID;
+		}
+
+		template< class objectType, typename IDType > void LooseChunkMap< objectType, IDType >::move(IDType objectID, sf::Vector2f position) {
+			objectStack[objectID]; // Throws for removed objects
+			Placement& placement = placements[slotOf(objectID)];
+			placement.position = position;
+			if(chunkAt(position) == placement.chunk) // Most moves stay inside the chunk
+				return;
+			unlist(objectID);
+			list(objectID);
+		}
+
+		template< class objectType, typename IDType > void LooseChunkMap< objectType, IDType >::resize(IDType objectID, sf::Vector2f halfSize) {
+			objectStack[objectID]; // Same as in move
+			if((halfSize.x < 0) || (halfSize.y < 0))
+				throw std::invalid_argument("LooseChunkMap half size can't be negative! halfSize = " + std::to_string(halfSize.x) + "x" + std::to_string(halfSize.y));
+			Placement& placement = placements[slotOf(objectID)];
+			placement.halfSize = halfSize;
+			Chunk& chunk = chunks[placement.chunk.x][placement.chunk.y];
+			chunk.reach.x = std::max(chunk.reach.x, halfSize.x); // A shrinking object leaves the reach as it is, which only makes queries visit the chunk a little more often
+			chunk.reach.y = std::max(chunk.reach.y, halfSize.y);
+			maxReach.x = std::max(maxReach.x, chunk.reach.x);
+			maxReach.y = std::max(maxReach.y, chunk.reach.y);
+		}
+
+		template< class objectType, typename IDType > void LooseChunkMap< objectType, IDType >::remove(IDType objectID) {
+			objectStack.del(objectID);
+			unlist(objectID);
+		}
+
+		template< class objectType, typename IDType > objectType& LooseChunkMap< objectType, IDType >::operator[](IDType objectID) {
+			return objectStack[objectID];
+		}
+
+		template< class objectType, typename IDType > sf::Vector2f LooseChunkMap< objectType, IDType >::getPosition(IDType objectID) {
+			objectStack[objectID]; // Same as in move
+			return placements[slotOf(objectID)].position;
+		}
+
+		template< class objectType, typename IDType > sf::Vector2f LooseChunkMap< objectType, IDType >::getHalfSize(IDType objectID) {
+			objectStack[objectID]; // Same as in move
+			return placements[slotOf(objectID)].halfSize;
+		}
+
+		template< class objectType, typename IDType > size_t LooseChunkMap< objectType, IDType >::size() {
+			return objectStack.size();
+		}
+
+		template< class objectType, typename IDType > bool LooseChunkMap< objectType, IDType >::contains(IDType objectID) {
+			return objectStack.contains(objectID);
+		}
+
+		template< class objectType, typename IDType > size_t LooseChunkMap< objectType, IDType >::slotOf(IDType objectID) {
+			return Sponge< objectType, IDType >::slotOf(objectID);
+		}
+
+		template< class objectType, typename IDType > void LooseChunkMap< objectType, IDType >::query(sf::Vector2f tlPoint, sf::Vector2f brPoint, std::vector< IDType >& out) {
+			if((tlPoint.x > brPoint.x) || (tlPoint.y > brPoint.y))
+				return;
+			// Objects centred up to maxReach outside of the rectangle can still overlap it
+			sf::Vector2u tlChunk(chunkAt(sf::Vector2f(tlPoint.x - maxReach.x, tlPoint.y - maxReach.y))),
+						 brChunk(chunkAt(sf::Vector2f(brPoint.x + maxReach.x, brPoint.y + maxReach.y)));
+			for(size_t x = tlChunk.x; x <= brChunk.x; ++x) {
+				for(size_t y = tlChunk.y; y <= brChunk.y; ++y) {
+					const Chunk& chunk = chunks[x][y];
+					if(chunk.objects.empty())
+						continue;
+					// Edge chunks also hold the objects past the edge of the map, so they reach out forever on that side
+					float left = (x == 0) ? -INFINITY : (x * chunkSize.x) - chunk.reach.x,
+						  top = (y == 0) ? -INFINITY : (y * chunkSize.y) - chunk.reach.y,
+						  right = (x == chunks.size() - 1) ? INFINITY : ((x + 1) * chunkSize.x) + chunk.reach.x,
+						  bottom = (y == chunks[0].size() - 1) ? INFINITY : ((y + 1) * chunkSize.y) + chunk.reach.y;
+					if((left > brPoint.x) || (right < tlPoint.x) || (top > brPoint.y) || (bottom < tlPoint.y))
+						continue;
+					for(IDType objectID : chunk.objects) {
+						const Placement& placement = placements[slotOf(objectID)];
+						if((placement.position.x + placement.halfSize.x >= tlPoint.x) && (placement.position.x - placement.halfSize.x <= brPoint.x) &&
+						   (placement.position.y + placement.halfSize.y >= tlPoint.y) && (placement.position.y - placement.halfSize.y <= brPoint.y))
+							out.push_back(objectID);
+					}
+				}
+			}
+		}
+
+		template< class objectType, typename IDType > void LooseChunkMap< objectType, IDType >::queryRadius(sf::Vector2f centre, float radius, std::vector< IDType >& out) {
+			size_t first = out.size();
+			query(sf::Vector2f(centre.x - radius, centre.y - radius), sf::Vector2f(centre.x + radius, centre.y + radius), out);
+			size_t kept = first;
+			for(size_t n = first; n < out.size(); ++n) {
+				const Placement& placement = placements[slotOf(out[n])];
+				float distX = centre.x - std::min(std::max(centre.x, placement.position.x - placement.halfSize.x), placement.position.x + placement.halfSize.x), // To the closest point of the box
+					  distY = centre.y - std::min(std::max(centre.y, placement.position.y - placement.halfSize.y), placement.position.y + placement.halfSize.y);
+				if((distX * distX) + (distY * distY) <= radius * radius)
+					out[kept++] = out[n];
+			}
+			out.resize(kept);
+		}
+
+		template< class objectType, typename IDType > LooseChunkMap< objectType, IDType >::LooseChunkMap(sf::Vector2f chunkmapSize, sf::Vector2f chunkmapChunkSize) :
+			chunkSize(chunkmapChunkSize),
+			mapSize(chunkmapSize),
+			maxReach(0, 0)
+		{
+			if((chunkSize.x <= 0) || (chunkSize.y <= 0))
+				throw std::invalid_argument("LooseChunkMap chunk size must be positive! chunkSize = " + std::to_string(chunkSize.x) + "x" + std::to_string(chunkSize.y));
+			size_t chunksX = std::max(size_t(std::ceil(mapSize.x / chunkSize.x)), size_t(1)),
+				   chunksY = std::max(size_t(std::ceil(mapSize.y / chunkSize.y)), size_t(1));
+			chunks.assign(chunksX, std::vector< Chunk >(chunksY));
+		}
 }
 
 #endif
\ No newline at end of file
@@ -1,8 +1,170 @@
 #include "light.hpp"
+#include <set>
 
 // sfte::PointLight implementation
-sfte::PointLight::PointLight(sf::Vector2f lightPosition, float lightRadius, sf::Color lightColor) :
+sfte::PointLight::PointLight(sf::Vector2f lightPosition, float lightRadius, sf::Color lightColor, float lightSourceRadius, unsigned int lightQuality) :
 	position(lightPosition),
 	radius(lightRadius),
-	color(lightColor)
-{ }
\ No newline at end of file
+	color(lightColor),
+	sourceRadius(lightSourceRadius),
+	quality(lightQuality)
+{ }
+
+// sfte::sweepLightPolygon implementation
+namespace {
+	struct SweepEdge {
+		const sfte::OccluderEdge* edge;
+		float end;				// Angle at which the edge stops being crossed by the sweep.
+		sf::Vector2f endPoint;	// Its end at that angle.
+	};
+
+	struct SweepEvent {
+		float angle;
+		sf::Vector2f point;
+		size_t edge;			// Index into the SweepEdges, or none for a bounds corner.
+		bool insert;
+
+		bool operator<(const SweepEvent& r) const { return angle < r.angle; }
+	};
+
+	const size_t none = size_t(-1);
+
+	// How far along the ray from origin in direction the edge's line is, in multiples of direction. Exactly 1 when direction points at a point on the edge.
+	float rayDistance(sf::Vector2f origin, sf::Vector2f direction, const sfte::OccluderEdge& edge) {
+		float along = edge.x ? direction.x : direction.y;
+		return (along == 0) ? INFINITY : ((edge.a - (edge.x ? origin.x : origin.y)) / along);
+	}
+
+	struct SweepOrder { // Nearest edge along the current ray first. Edges crossed by the same ray never cross each other, so the order stays valid as the ray turns.
+		const std::vector< SweepEdge >* edges;
+		const sf::Vector2f* origin;
+		const sf::Vector2f* direction;
+
+		bool operator()(size_t l, size_t r) const {
+			const SweepEdge& lEdge = (*edges)[l];
+			const SweepEdge& rEdge = (*edges)[r];
+			float lDist = rayDistance(*origin, *direction, *lEdge.edge),
+				  rDist = rayDistance(*origin, *direction, *rEdge.edge);
+			if(lDist != rDist)
+				return lDist < rDist;
+
+			// They meet on the current ray. The nearer one is the nearer one where the first of them ends.
+			const SweepEdge& first = (lEdge.end <= rEdge.end) ? lEdge : rEdge;
+			const SweepEdge& other = (lEdge.end <= rEdge.end) ? rEdge : lEdge;
+			float otherDist = rayDistance(*origin, first.endPoint - *origin, *other.edge);
+			if(otherDist != 1)
+				return (otherDist < 1) == (&other == &lEdge);
+			return l < r;
+		}
+	};
+}
+
+void sfte::sweepLightPolygon(sf::Vector2f origin, const std::vector< OccluderEdge >& edges, float leftB, float upB, float rightB, float downB, float bleed, std::vector< sf::Vector2f >& polygon) {
+	/*
+	Angular sweep. Every edge end and bounds corner is an event, and the events are sorted by angle once. The edges crossed
+	by the ray at the current angle are kept in a set ordered by distance, so the nearest one is always at the front. The
+	sweep goes from -pi to pi like the atan2 sort of the ray caster, so the points come out in polygon order without
+	sorting them again.
+	*/
+	Scratch< SweepEdge > sweepEdgesBuffer;
+	Scratch< SweepEvent > eventsBuffer;
+	Scratch< size_t > startActiveBuffer;
+	std::vector< SweepEdge >& sweepEdges = *sweepEdgesBuffer;
+	std::vector< SweepEvent >& events = *eventsBuffer;
+	std::vector< size_t >& startActive = *startActiveBuffer;	// Edges crossing the ray at -pi, where the sweep starts.
+	polygon.clear();
+	if((rightB <= leftB) || (downB <= upB))
+		return; // Nothing is lit, e.g. a light of radius 0
+	sweepEdges.reserve(edges.size());
+	events.reserve((edges.size() * 2) + 4);
+
+	for(const OccluderEdge& edge : edges) {
+		if(edge.a == (edge.x ? origin.x : origin.y))
+			continue; // On a line through the origin, so it is only ever seen edge on
+		sf::Vector2f start = edge.x ? sf::Vector2f(edge.a, edge.s) : sf::Vector2f(edge.s, edge.a),
+					 end = edge.x ? sf::Vector2f(edge.a, edge.b) : sf::Vector2f(edge.b, edge.a);
+		float startAngle = pseudoAngle(start.x - origin.x, start.y - origin.y),
+			  endAngle = pseudoAngle(end.x - origin.x, end.y - origin.y);
+		if(startAngle > endAngle) {
+			std::swap(start, end);
+			std::swap(startAngle, endAngle);
+		}
+
+		size_t index = sweepEdges.size();
+		if(endAngle - startAngle > 2) { // Crosses -pi. Crossed from the start until startAngle, then again from endAngle on.
+			sweepEdges.push_back(SweepEdge{&edge, startAngle, start});
+			startActive.push_back(index);
+			events.push_back(SweepEvent{startAngle, start, index, false});
+			events.push_back(SweepEvent{endAngle, end, index, true});
+		}
+		else {
+			sweepEdges.push_back(SweepEdge{&edge, endAngle, end});
+			events.push_back(SweepEvent{startAngle, start, index, true});
+			events.push_back(SweepEvent{endAngle, end, index, false});
+		}
+	}
+	sf::Vector2f corners[] = {sf::Vector2f(leftB, upB), sf::Vector2f(rightB, upB), sf::Vector2f(rightB, downB), sf::Vector2f(leftB, downB)};
+	for(sf::Vector2f corner : corners) {
+		if(corner == origin)
+			continue; // No direction. The corners on either side of it still bound the polygon.
+		events.push_back(SweepEvent{pseudoAngle(corner.x - origin.x, corner.y - origin.y), corner, none, false});
+	}
+	std::sort(events.begin(), events.end());
+
+	sf::Vector2f direction(-1, 0);
+	std::set< size_t, SweepOrder > active(SweepOrder{&sweepEdges, &origin, &direction});
+	Scratch< std::set< size_t, SweepOrder >::iterator > activeAtBuffer;
+	std::vector< std::set< size_t, SweepOrder >::iterator >& activeAt = *activeAtBuffer;
+	activeAt.assign(sweepEdges.size(), active.end());
+	for(size_t index : startActive)
+		activeAt[index] = active.insert(index).first;
+
+	// Point where the ray at the current angle stops: the nearest edge crossed, or the bounds if there's none, pushed out by bleed
+	auto cast = [&]() {
+		float exitDist = std::min((direction.x > 0) ? ((rightB - origin.x) / direction.x) : (direction.x < 0) ? ((leftB - origin.x) / direction.x) : INFINITY,
+								  (direction.y > 0) ? ((downB - origin.y) / direction.y) : (direction.y < 0) ? ((upB - origin.y) / direction.y) : INFINITY),
+			  dist = active.empty() ? INFINITY : rayDistance(origin, direction, *sweepEdges[*active.begin()].edge);
+		if(dist >= exitDist)
+			return origin + (direction * exitDist);
+		if(bleed != 0.0f)
+			dist = std::min(dist + (bleed / std::sqrt((direction.x * direction.x) + (direction.y * direction.y))), exitDist);
+		return origin + (direction * dist);
+	};
+
+	for(size_t n = 0; n < events.size();) {
+		size_t groupEnd = n;
+		do // Always takes event n, so the sweep moves on even if an angle doesn't compare equal to itself
+			++groupEnd;
+		while((groupEnd < events.size()) && (events[groupEnd].angle == events[n].angle));
+
+		// Cast once with the edges ending at this angle and once with the ones starting at it. The two points differ where
+		// the ray passes the corner of an occluder, and the light carries on behind it.
+		direction = events[n].point - origin;
+		polygon.push_back(cast());
+		for(size_t event = n; event < groupEnd; ++event) {
+			if((events[event].edge != none) && !events[event].insert && (activeAt[events[event].edge] != active.end())) {
+				active.erase(activeAt[events[event].edge]);
+				activeAt[events[event].edge] = active.end();
+			}
+		}
+		for(size_t event = n; event < groupEnd; ++event) {
+			if((events[event].edge != none) && events[event].insert) {
+				size_t edge = events[event].edge;
+				if(sweepEdges[edge].end < events[event].angle)
+					sweepEdges[edge].end += 4; // Crosses -pi. Its second part ends where the first ended, one turn later.
+				direction = events[event].point - origin;
+				activeAt[edge] = active.insert(edge).first;
+			}
+		}
+		direction = events[n].point - origin;
+		sf::Vector2f after = cast();
+		if(after != polygon.back())
+			polygon.push_back(after);
+		n = groupEnd;
+	}
+
+	// From a corner of the bounds the light only covers a quarter turn. Closing the polygon through the origin keeps it from
+	// cutting straight across that quarter, over whatever is in the shadows there.
+	if(((origin.x == leftB) || (origin.x == rightB)) && ((origin.y == upB) || (origin.y == downB)))
+		polygon.push_back(origin);
+}
\ No newline at end of file
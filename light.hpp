@@ -4,31 +4,143 @@
 #include "world.hpp"
 #include "containers.hpp"
 #include "physics.hpp"
+#include "parallel.hpp"
+#include "lightbackend.hpp"
+#include "memory.hpp"
 
 namespace sfte {
 	struct PointLight {
 		sf::Vector2f position;
 		float radius;
 		sf::Color color;
+		float sourceRadius;		// Radius of the light itself, in pixels. Shadows get a penumbra as wide as it looks from the occluder. 0 = hard shadows.
+		unsigned int quality;	// Light polygons cast across the source for the penumbra, the first from its centre. 1 = hard shadows.
 
-		PointLight(sf::Vector2f lightPosition, float lightRadius, sf::Color lightColor = sf::Color::White);
+		PointLight(sf::Vector2f lightPosition, float lightRadius, sf::Color lightColor = sf::Color::White, float lightSourceRadius = 0, unsigned int lightQuality = 1);
 	};
 
+	enum LightEngine {		// How LightMap computes light polygons from the merged edges in the light's box.
+		lightEngineRaycast,	// A DDA ray through every end of an edge. Cost grows with the edges times the ray length.
+		lightEngineSweep	// One angular sweep over the edges. O(E log E) in the edges.
+	};
+
+	// Visibility polygon of origin among edges, inside the bounds, sorted by angle. Gives the point castLightRay would for every edge end
+	// and bounds corner, plus the point behind it where the ray passes the corner of an occluder. Everything is in tiles. Empty if the
+	// bounds have no area. The origin may be on the bounds, even on a corner.
+	void sweepLightPolygon(sf::Vector2f origin, const std::vector< OccluderEdge >& edges, float leftB, float upB, float rightB, float downB, float bleed, std::vector< sf::Vector2f >& polygon);
+
 	template < class worldTileIDType, typename IDType = size_t > class LightMap {
 		World < worldTileIDType >* targetWorld;				// World with all the occluders.
-		PointChunkMap < PointLight, IDType > lightChunks;	// PointLight chunks for storing them.
-		sf::RenderTexture lightmap;							// TO REPLACE WITH ObjectGrid < sf::RenderTexture > LATER ON!
+		LooseChunkMap < PointLight, IDType > lightChunks;	// PointLight chunks for storing them. Each light is a box of its reach.
+		std::unique_ptr < LightBackend > backend;			// Where the light of a frame is added up and composited.
 		CollisionProperties* collisionProperties;			// Pointer to CollisionProperties table for collision checking.
 		std::vector< PhysicsProperty >* physicsProperties;	// Pointer to PhysicsProperty table for collision checking.
-		sf::VertexArray va;									// Vertex array to iterate over lights
-		sf::Vector2f viewSize;								// Possibly temporary. Size of window.
-
+		EdgeMesh < worldTileIDType > edgeMesh;				// Merged occluder edges of the world, which rays are cast at.
+		std::vector < std::vector < EdgeArrays > > tileEdges;	// collisionProperties->edges as EdgeArrays, for castLightRay. [collisionID][bitmask].
+		sf::VertexArray va;									// Triangles of every light submitted this frame, drawn in one call.
+		sf::Vector2f viewSize;								// Size of the view when the frame began. The lightmap follows it.
+		sf::Vector2f viewPosition;							// Top left of the view when the frame began.
+		sf::Color ambientColor;								// What the lightmap is cleared to, so the colour of places no light reaches.
+
+		struct LightSample {								// One light polygon of a light, cast from a point of its source.
+			sf::Vector2f origin;							// In pixels, like the light's position.
+			std::vector < sf::Vector2f > polygon;
+		};
+		std::vector < LightSample > samples;				// Light polygons of submit, reused for every light.
+		std::vector < IDType > visibleLights;				// Lights found by render, reused every frame.
+
+		struct LightCache {									// A light's polygons and what they were computed from. Polygons are in tiles, so they don't move with the view.
+			std::vector < LightSample > samples;
+			sf::Vector2f position;
+			float radius = 0,
+				  bleed = 0,
+				  sourceRadius = 0;
+			unsigned int quality = 0;
+			size_t rays = 0;								// Cast for the polygons, see calcLightPolygon.
+			unsigned long revision = 0;						// World revision of the area the polygons' rays can reach.
+			bool valid = false;
+		};
+		std::vector < LightCache > lightCache;				// Indexed by the slot of the light's ID, see LooseChunkMap::slotOf.
+		std::vector < IDType > staleLights;					// Visible lights whose polygon has to be recomputed this frame.
+		std::unique_ptr < WorkerPool > workers;				// Threads the polygons are computed on.
+		float bleed;										// Bleed of the lights drawn by render.
+		LightEngine engine;									// How light polygons are computed.
+		size_t rayCap;										// Most rays cast for one light's polygons. The one from the centre is cast even past it.
+		float scale,										// Size of the lightmap relative to the view, as set by setScale.
+			  frameScale,									// Scale in use. Below scale while frames go over frameBudget.
+			  frameBudget;									// Seconds a frame may take before frameScale drops. 0 = frameScale stays at scale.
+		sf::Clock frameClock;								// Time since the last beginFrame.
+		unsigned int slowFrames,							// Frames in a row over frameBudget, and well under it.
+					 fastFrames;
+
+		// Fill polygon with the light's polygon, sorted by angle. false if the light is outside the world, or if it needs more than rays
+		// rays, in which case none is cast. A ray is cast for each bounds corner and edge end, and rays is reduced by the rays cast.
+		// Only reads the world and the tables, so several lights can be computed at once.
+		bool calcLightPolygon(sf::Vector2f position, float radius, float bleed, std::vector < sf::Vector2f >& polygon, size_t& rays) const;
+		// The light polygons of every penumbra sample of the light which fits in rayCap. Skips the samples inside a tangible tile or outside of the world.
+		// Returns the rays cast.
+		size_t calcLightSamples(const PointLight& light, float bleed, std::vector < LightSample >& lightSamples) const;
+		unsigned long calcLightRevision(sf::Vector2f position, float radius);
+		void updateEdgeMesh(sf::Vector2f position, float radius); // Has to be called before calcLightPolygon, from one thread
+		bool nearestTileEdge(int x, int y, sf::Vector2f point, sf::Vector2f direction, float from, float& hit) const; // nearestEdgeHit with the edges of the tile at x, y. false if it isn't tangible
+		void buildTileEdges();
+		void updateLightPolygons(); // Recompute the polygons of the visible lights whose cache is stale, in parallel
+		void resizeLightmap(); // Make the lightmap viewSize * frameScale, if it isn't already
+		void appendLight(sf::Vector2f position, const std::vector < sf::Vector2f >& polygon, sf::Color color);
+		void appendLight(const std::vector < LightSample >& lightSamples, sf::Color color); // The colour is split between the samples
 	public:
-		void castLightRay(float x1, float y1, float x2, float y2, float leftB, float upB, float rightB, float downB, float bleed, std::vector < sf::Vector2f >* vec);
-		void render(sf::Vector2f tlScreenPoint, sf::Vector2f brScreenPoint);
-		void renderLight(sf::Vector2f position, float radius, float bleed);
-
-		LightMap(World < worldTileIDType >* world, CollisionProperties* collisionProps, std::vector< PhysicsProperty >* physicsProps);
+		void castLightRay(float x1, float y1, float x2, float y2, float leftB, float upB, float rightB, float downB, float bleed, std::vector < sf::Vector2f >* vec) const; // Safe to call from several threads at once, as long as the world isn't edited meanwhile
+		void render(sf::Vector2f tlScreenPoint, sf::Vector2f brScreenPoint); // Without a render target in the world, the lightmap covers the screen points
+
+		// Frame-level light rendering: every light submitted between beginFrame and resolve is added into the lightmap,
+		// then the lightmap is multiplied onto the target once. The lightmap is only cleared and composited once per frame.
+		// The lightmap covers the view of the world's render target, or a view given by its top left and size in pixels, which
+		// works without a render target. Without one and without a view given, the view of the last frame is kept.
+		void beginFrame();
+		void beginFrame(sf::Vector2f position, sf::Vector2f size);
+		void submit(sf::Vector2f position, float radius, float bleed, sf::Color color = sf::Color::White);
+		void submit(const PointLight& light, float bleed);
+		void resolve(); // Onto the world's render target. Without one, only accumulates.
+		void resolve(sf::RenderTarget* target); // nullptr = only accumulate, e.g. to read a SoftwareLightBackend back without OpenGL
+		void renderLight(sf::Vector2f position, float radius, float bleed); // A frame with only this light
+
+		// The lightmap is drawn at a fraction of the view's size and smoothly scaled up when it is composited, which divides its fill
+		// cost by 1 / scale^2. With a frame budget, the scale halves (down to 1/4) while frames take longer, and comes back once they don't.
+		void setScale(float lightmapScale); // 1, 0.5 or 0.25 make the lightmap's pixels line up with the view's
+		float getScale();
+		float getFrameScale(); // The scale actually used
+		void setFrameBudget(float seconds); // 0 = off
+		float getFrameBudget();
+
+		void setAmbientColor(sf::Color color);
+		sf::Color getAmbientColor();
+
+		// Light management. Positions and radii are in pixels. render draws only the lights which reach into the view. A light
+		// reaches radius + sourceRadius from its position, as its penumbra samples start anywhere on its source.
+		IDType addLight(const PointLight& light);
+		void moveLight(IDType lightID, sf::Vector2f position);
+		void setLightRadius(IDType lightID, float radius);
+		void setLightColor(IDType lightID, sf::Color color);
+		void setLightSourceRadius(IDType lightID, float sourceRadius);
+		void setLightQuality(IDType lightID, unsigned int quality);
+		void removeLight(IDType lightID);
+		const PointLight& getLight(IDType lightID);
+		size_t getLightCount();
+		size_t getLightRays(IDType lightID); // Rays cast for the light's polygons when render last computed them. Never more than the rayCap, or the centre polygon's.
+		void setBleed(float lightBleed);
+		float getBleed();
+		void clearLightCache(); // Recompute every light polygon. Needed after changing the collision or physics properties tables.
+		void setThreadCount(size_t threads); // Threads to compute light polygons on, including the rendering one. 0 = workerCount().
+		size_t getThreadCount();
+		void setEngine(LightEngine lightEngine);
+		LightEngine getEngine();
+		void setRayCap(size_t cap); // Penumbra samples which would take a light's rays past it aren't cast. The polygon from the centre always is.
+		size_t getRayCap();
+
+		LightBackend* getBackend();
+
+		// lightBackend is owned by the LightMap. nullptr = a RenderTextureLightBackend.
+		LightMap(World < worldTileIDType >* world, CollisionProperties* collisionProps, std::vector< PhysicsProperty >* physicsProps, LightBackend* lightBackend = nullptr);
 	};
 
 	/* sfte::LightMap implementation.
@@ -38,18 +150,32 @@ namespace sfte {
 			;
 		}
 	*/
-		template< class worldTileIDType, typename IDType > LightMap< worldTileIDType, IDType >::LightMap(World < worldTileIDType >* world, CollisionProperties* collisionProps, std::vector< PhysicsProperty >* physicsProps) :
-		    va(sf::TrianglesFan),
-		    viewSize(world->getRenderTarget()->getView().getSize())
+		template< class worldTileIDType, typename IDType > LightMap< worldTileIDType, IDType >::LightMap(World < worldTileIDType >* world, CollisionProperties* collisionProps, std::vector< PhysicsProperty >* physicsProps, LightBackend* lightBackend) :
+		    lightChunks(sf::Vector2f(world->getTilemapSize().x * world->getTileSize().x, world->getTilemapSize().y * world->getTileSize().y),
+		    			sf::Vector2f(float(World < worldTileIDType >::chunkSize) * world->getTileSize().x, float(World < worldTileIDType >::chunkSize) * world->getTileSize().y)),
+		    backend((lightBackend != nullptr) ? lightBackend : new RenderTextureLightBackend()),
+		    edgeMesh(world, collisionProps, physicsProps),
+		    va(sf::Triangles),
+		    viewSize((world->getRenderTarget() != nullptr) ? world->getRenderTarget()->getView().getSize() : sf::Vector2f(0, 0)),
+		    ambientColor(64, 64, 64),
+		    workers(new WorkerPool()),
+		    bleed(0),
+		    engine(lightEngineRaycast),
+		    rayCap(4096),
+		    scale(1),
+		    frameScale(1),
+		    frameBudget(0),
+		    slowFrames(0),
+		    fastFrames(0)
 		{
 			targetWorld = world;
 			collisionProperties = collisionProps;
 			physicsProperties = physicsProps;
-
-			lightmap.create(ceil(viewSize.x), ceil(viewSize.y));
+			buildTileEdges();
+			resizeLightmap();
 		}
 
-		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::castLightRay(float x1, float y1, float x2, float y2, float leftB, float upB, float rightB, float downB, float bleed, std::vector < sf::Vector2f >* vec) {
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::castLightRay(float x1, float y1, float x2, float y2, float leftB, float upB, float rightB, float downB, float bleed, std::vector < sf::Vector2f >* vec) const {
 			// The DDA algorithm used here was taken from: http://lodev.org/cgtutor/raycasting.html
 			// All credits regarding the DDA go to the author of the algorithm. Thank you whoever made it!
 
@@ -67,36 +193,13 @@ namespace sfte {
 					int endY = floor(y2); // No endX needed, x remains equal
 
 					while(y <= endY) {
-						IDType tileID = targetWorld->tile(sf::Vector3u(x, y, 0));
-						if(physicsProperties->at(tileID).tangible) {
-							unsigned char bitmask = targetWorld->getTileBitmask(sf::Vector3u(x, y, 0));
-							size_t colID = physicsProperties->at(tileID).collisionID,
-								   iMax = collisionProperties->edges[colID][bitmask].size();
-							bool found = false;
-							float lastDist;
-							sf::Vector2f final;
-
-							for(size_t i = 0; i < iMax; ++i) {
-								if(!collisionProperties->edges[colID][bitmask][i].x) { // y aligned (- shape)
-									if((x1 >= (collisionProperties->edges[colID][bitmask][i].s + x)) && (x1 <= (collisionProperties->edges[colID][bitmask][i].b + x))) {
-										float thisDist = collisionProperties->edges[colID][bitmask][i].a + y - y1;
-										if((!found) || (thisDist < lastDist)) {
-											lastDist = thisDist;
-											found = true;
-											final.y = collisionProperties->edges[colID][bitmask][i].a + y;
-										}
-									}
-								}
-							}
-
-							if(found) {
-								final.x = x1;
-								final.y += bleed;
-								if(final.y > downB)
-									final.y = downB;
-								vec->push_back(final);
-								return;
-							}
+						float hit;
+						if(nearestTileEdge(x, y, sf::Vector2f(x1, y1), sf::Vector2f(0, 1), 0, hit)) {
+							sf::Vector2f final(x1, y1 + hit + bleed);
+							if(final.y > downB)
+								final.y = downB;
+							vec->push_back(final);
+							return;
 						}
 
 						++y;
@@ -108,36 +211,13 @@ namespace sfte {
 					int endY = floor(y2); // No endX needed, x remains equal
 
 					while(y >= endY) {
-						IDType tileID = targetWorld->tile(sf::Vector3u(x, y, 0));
-						if(physicsProperties->at(tileID).tangible) {
-							unsigned char bitmask = targetWorld->getTileBitmask(sf::Vector3u(x, y, 0));
-							size_t colID = physicsProperties->at(tileID).collisionID,
-								   iMax = collisionProperties->edges[colID][bitmask].size();
-							bool found = false;
-							float lastDist;
-							sf::Vector2f final;
-
-							for(size_t i = 0; i < iMax; ++i) {
-								if(!collisionProperties->edges[colID][bitmask][i].x) { // y aligned (- shape)
-									if((x1 >= (collisionProperties->edges[colID][bitmask][i].s + x)) && (x1 <= (collisionProperties->edges[colID][bitmask][i].b + x))) {
-										float thisDist = y1 - collisionProperties->edges[colID][bitmask][i].a - y;
-										if((!found) || (thisDist < lastDist)) {
-											lastDist = thisDist;
-											found = true;
-											final.y = collisionProperties->edges[colID][bitmask][i].a + y;
-										}
-									}
-								}
-							}
-
-							if(found) {
-								final.x = x1;
-								final.y -= bleed;
-								if(final.y < upB)
-									final.y = upB;
-								vec->push_back(final);
-								return;
-							}
+						float hit;
+						if(nearestTileEdge(x, y, sf::Vector2f(x1, y1), sf::Vector2f(0, -1), 0, hit)) {
+							sf::Vector2f final(x1, y1 - hit - bleed);
+							if(final.y < upB)
+								final.y = upB;
+							vec->push_back(final);
+							return;
 						}
 
 						--y;
@@ -154,36 +234,13 @@ namespace sfte {
 					int endX = floor(x2); // No endY needed, y remains equal
 
 					while(x <= endX) {
-						IDType tileID = targetWorld->tile(sf::Vector3u(x, y, 0));
-						if(physicsProperties->at(tileID).tangible) {
-							unsigned char bitmask = targetWorld->getTileBitmask(sf::Vector3u(x, y, 0));
-							size_t colID = physicsProperties->at(tileID).collisionID,
-								   iMax = collisionProperties->edges[colID][bitmask].size();
-							bool found = false;
-							float lastDist;
-							sf::Vector2f final;
-
-							for(size_t i = 0; i < iMax; ++i) {
-								if(collisionProperties->edges[colID][bitmask][i].x) { // x aligned (| shape)
-									if((y1 >= (collisionProperties->edges[colID][bitmask][i].s + y)) && (y1 <= (collisionProperties->edges[colID][bitmask][i].b + y))) {
-										float thisDist = collisionProperties->edges[colID][bitmask][i].a + x - x1;
-										if((!found) || (thisDist < lastDist)) {
-											lastDist = thisDist;
-											found = true;
-											final.x = collisionProperties->edges[colID][bitmask][i].a + x;
-										}
-									}
-								}
-							}
-
-							if(found) {
-								final.x += bleed;
-								if(final.x > rightB)
-									final.x = rightB;
-								final.y = y1;
-								vec->push_back(final);
-								return;
-							}
+						float hit;
+						if(nearestTileEdge(x, y, sf::Vector2f(x1, y1), sf::Vector2f(1, 0), 0, hit)) {
+							sf::Vector2f final(x1 + hit + bleed, y1);
+							if(final.x > rightB)
+								final.x = rightB;
+							vec->push_back(final);
+							return;
 						}
 
 						++x;
@@ -195,36 +252,13 @@ namespace sfte {
 					int endX = floor(x2); // No endY needed, y remains equal
 
 					while(x >= endX) {
-						IDType tileID = targetWorld->tile(sf::Vector3u(x, y, 0));
-						if(physicsProperties->at(tileID).tangible) {
-							unsigned char bitmask = targetWorld->getTileBitmask(sf::Vector3u(x, y, 0));
-							size_t colID = physicsProperties->at(tileID).collisionID,
-								   iMax = collisionProperties->edges[colID][bitmask].size();
-							bool found = false;
-							float lastDist;
-							sf::Vector2f final;
-
-							for(size_t i = 0; i < iMax; ++i) {
-								if(collisionProperties->edges[colID][bitmask][i].x) { // x aligned (| shape)
-									if((y1 >= (collisionProperties->edges[colID][bitmask][i].s + y)) && (y1 <= (collisionProperties->edges[colID][bitmask][i].b + y))) {
-										float thisDist = x1 - collisionProperties->edges[colID][bitmask][i].a - x;
-										if((!found) || (thisDist < lastDist)) {
-											lastDist = thisDist;
-											found = true;
-											final.x = collisionProperties->edges[colID][bitmask][i].a + x;
-										}
-									}
-								}
-							}
-
-							if(found) {
-								final.x -= bleed;
-								if(final.x < leftB)
-									final.x = leftB;
-								final.y = y1;
-								vec->push_back(final);
-								return;
-							}
+						float hit;
+						if(nearestTileEdge(x, y, sf::Vector2f(x1, y1), sf::Vector2f(-1, 0), 0, hit)) {
+							sf::Vector2f final(x1 - hit - bleed, y1);
+							if(final.x < leftB)
+								final.x = leftB;
+							vec->push_back(final);
+							return;
 						}
 
 						--x;
@@ -235,6 +269,7 @@ namespace sfte {
 				// Calculate gradient and y-intersect:
 				float m = (y2 - y1) / (x2 - x1),
 					  c = y2 - (m * x2);
+				sf::Vector2f target(x2, y2); // Edges are crossed relative to it, so a ray cast at the end of an edge hits it exactly
 
 				extendRayToBounds(x1, y1, x2, y2, m, c, leftB, upB, rightB, downB); // Extend ray to remove OOB checks
 
@@ -275,54 +310,13 @@ namespace sfte {
 				}
 
 				do {
-					IDType tileID = targetWorld->tile(sf::Vector3u(x, y, 0));
-					if(physicsProperties->at(tileID).tangible) {
-						unsigned char bitmask = targetWorld->getTileBitmask(sf::Vector3u(x, y, 0));
-						size_t colID = physicsProperties->at(tileID).collisionID,
-							   iMax = collisionProperties->edges[colID][bitmask].size();
-						bool found = false;
-						float lastDist;
-						sf::Vector2f final;
-
-						for(size_t i = 0; i < iMax; ++i) {
-							if(collisionProperties->edges[colID][bitmask][i].x) { // x aligned (| shape)
-								float thisX = collisionProperties->edges[colID][bitmask][i].a + x,
-									  thisY = (m * thisX) + c;
-								if((thisY >= (collisionProperties->edges[colID][bitmask][i].s + y)) && (thisY <= (collisionProperties->edges[colID][bitmask][i].b + y))) {
-									float distX = x1 - thisX,
-										  distY = y1 - thisY,
-										  thisDist = std::sqrt((distX * distX) + (distY * distY));
-									if((!found) || (thisDist < lastDist)) {
-										lastDist = thisDist;
-										found = true;
-										final.x = thisX;
-										final.y = thisY;
-									}
-								}
-							}
-							else { // y aligned (- shape)
-								float thisY = collisionProperties->edges[colID][bitmask][i].a + y,
-									  thisX = (thisY - c) / m;
-								if((thisX >= (collisionProperties->edges[colID][bitmask][i].s + x)) && (thisX <= (collisionProperties->edges[colID][bitmask][i].b + x))) {
-									float distX = x1 - thisX,
-										  distY = y1 - thisY,
-										  thisDist = std::sqrt((distX * distX) + (distY * distY));
-									if((!found) || (thisDist < lastDist)) {
-										lastDist = thisDist;
-										found = true;
-										final.x = thisX;
-										final.y = thisY;
-									}
-								}
-							}
-						}
-
-						if(found) {
-							if(bleed != 0.0f)
-								extendRayCircle(x1, y1, final.x, final.y, bleed, m, c, leftB, upB, rightB, downB);
-							vec->push_back(final);
-							return;
-						}
+					float hit;
+					if(nearestTileEdge(x, y, target, sf::Vector2f(rayDirX, rayDirY), (x1 - target.x) / rayDirX, hit)) {
+						sf::Vector2f final(target.x + (hit * rayDirX), target.y + (hit * rayDirY));
+						if(bleed != 0.0f)
+							extendRayCircle(x1, y1, final.x, final.y, bleed, m, c, leftB, upB, rightB, downB);
+						vec->push_back(final);
+						return;
 					}
 
 					if(sideDistX < sideDistY) {
@@ -338,7 +332,26 @@ namespace sfte {
 			vec->push_back(sf::Vector2f(x2, y2));
 		}
 
-		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::renderLight(sf::Vector2f position, float radius, float bleed) {
+		template< class worldTileIDType, typename IDType > bool LightMap< worldTileIDType, IDType >::nearestTileEdge(int x, int y, sf::Vector2f point, sf::Vector2f direction, float from, float& hit) const {
+			worldTileIDType tileID = targetWorld->tile(sf::Vector3u(x, y, 0));
+			if(!physicsProperties->at(tileID).tangible)
+				return false;
+			const EdgeArrays& edges = tileEdges[physicsProperties->at(tileID).collisionID][targetWorld->getTileBitmask(sf::Vector3u(x, y, 0))];
+			return nearestEdgeHit(sf::Vector2f(point.x - x, point.y - y), direction, from, edges, hit); // The tile's edges are relative to it
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::buildTileEdges() {
+			tileEdges.assign(collisionProperties->edges.size(), std::vector< EdgeArrays >());
+			for(size_t colID = 0; colID < collisionProperties->edges.size(); ++colID) {
+				tileEdges[colID].resize(collisionProperties->edges[colID].size());
+				for(size_t bitmask = 0; bitmask < collisionProperties->edges[colID].size(); ++bitmask) {
+					for(const pb::Edge& edge : collisionProperties->edges[colID][bitmask])
+						tileEdges[colID][bitmask].add(edge.x, edge.a, edge.s, edge.b);
+				}
+			}
+		}
+
+		template< class worldTileIDType, typename IDType > bool LightMap< worldTileIDType, IDType >::calcLightPolygon(sf::Vector2f position, float radius, float bleed, std::vector< sf::Vector2f >& polygon, size_t& rays) const {
 	        sf::Vector2u tilesize(targetWorld->getTileSize());
 	        sf::Vector2f worldbound(targetWorld->getTilemapSize().x - (0.5f / float(tilesize.x)), targetWorld->getTilemapSize().y - (0.5f / float(tilesize.y)));
 
@@ -350,10 +363,10 @@ namespace sfte {
 	        	  y2 = (position.y + radius) / tilesize.y;
 
 	        if((oX < 0) || (oX > worldbound.x) || (oY < 0) || (oY > worldbound.y)) {
-	        	return;
+	        	return false;
 	        }
 
-			std::vector < sf::Vector2f > points; // Vector to store collision points for later ordering
+			polygon.clear(); // Collision points, ordered later
 
 	        if(x1 < 0) {
 	        	x1 = 0;
@@ -380,43 +393,401 @@ namespace sfte {
 	        	y2 = worldbound.y;
 	        }
 
+	        Scratch< OccluderEdge > edges;
+	        edgeMesh.query(floor(x1), floor(y1), floor(x2) + 1, floor(y2) + 1, *edges); // Edges of the tiles the box touches
+	        if(engine == lightEngineSweep) {
+	        	if(4 + (edges->size() * 2) > rays)
+	        		return false;
+	        	rays -= 4 + (edges->size() * 2);
+	        	sweepLightPolygon(sf::Vector2f(oX, oY), *edges, x1, y1, x2, y2, bleed, polygon);
+	        	return true;
+	        }
+
+	        // One ray through each edge end. Ends are mostly shared by two edges, so duplicates are removed first.
+	        Scratch< sf::Vector2f > ends;
+	        ends->reserve(edges->size() * 2);
+	        for(const OccluderEdge& edge : *edges) {
+	        	ends->push_back(edge.x ? sf::Vector2f(edge.a, edge.s) : sf::Vector2f(edge.s, edge.a));
+	        	ends->push_back(edge.x ? sf::Vector2f(edge.a, edge.b) : sf::Vector2f(edge.b, edge.a));
+	        }
+	        std::sort(ends->begin(), ends->end(), [](sf::Vector2f a, sf::Vector2f b) { return (a.x != b.x) ? (a.x < b.x) : (a.y < b.y); });
+	        ends->erase(std::unique(ends->begin(), ends->end()), ends->end());
+	        if(4 + ends->size() > rays)
+	        	return false;
+	        rays -= 4 + ends->size();
+
 			// Add screen corner points
-			castLightRay(oX, oY, x1, y1, x1, y1, x2, y2, bleed, &points); // TL
-			castLightRay(oX, oY, x2, y1, x1, y1, x2, y2, bleed, &points); // TR
-			castLightRay(oX, oY, x2, y2, x1, y1, x2, y2, bleed, &points); // BR
-			castLightRay(oX, oY, x1, y2, x1, y1, x2, y2, bleed, &points); // BL
-
-	        for(size_t x = floor(x1); x <= floor(x2); ++x) {
-	        	for(size_t y = floor(y1); y <= floor(y2); ++y) {
-					IDType tileID = targetWorld->tile(sf::Vector3u(x, y, 0));
-					if(!physicsProperties->at(tileID).tangible)
-						continue;
-					size_t id = physicsProperties->at(tileID).collisionID;
-					unsigned char bitmask = targetWorld->getTileBitmask(sf::Vector3u(x, y, 0));
-					for(size_t i = 0; i < collisionProperties->points[id][bitmask].size(); ++i)
-						castLightRay(oX, oY, float(x) + collisionProperties->points[id][bitmask][i].x, float(y) + collisionProperties->points[id][bitmask][i].y, x1, y1, x2, y2, bleed, &points);
-		        }
+			castLightRay(oX, oY, x1, y1, x1, y1, x2, y2, bleed, &polygon); // TL
+			castLightRay(oX, oY, x2, y1, x1, y1, x2, y2, bleed, &polygon); // TR
+			castLightRay(oX, oY, x2, y2, x1, y1, x2, y2, bleed, &polygon); // BR
+			castLightRay(oX, oY, x1, y2, x1, y1, x2, y2, bleed, &polygon); // BL
+
+	        for(sf::Vector2f end : *ends)
+	        	castLightRay(oX, oY, end.x, end.y, x1, y1, x2, y2, bleed, &polygon);
+
+	        std::sort(polygon.begin(), polygon.end(), [&oX, &oY](sf::Vector2f a, sf::Vector2f b) { return pseudoAngle(a.x - oX, a.y - oY) < pseudoAngle(b.x - oX, b.y - oY); });
+	        return true;
+	    }
+
+		template< class worldTileIDType, typename IDType > size_t LightMap< worldTileIDType, IDType >::calcLightSamples(const PointLight& light, float bleed, std::vector< LightSample >& lightSamples) const {
+	        /*
+	        Area light: the first polygon is cast from the centre, the others from points evenly spaced on the edge of the source.
+	        Where an occluder hides only some of them, only part of the light's colour arrives, which gives the penumbra.
+	        Every polygon after the centre one gets what is left of rayCap, and isn't cast at all if it needs more.
+	        */
+	        sf::Vector2u tilesize(targetWorld->getTileSize());
+	        unsigned int count = (light.sourceRadius > 0) ? std::max(light.quality, 1u) : 1;
+	        lightSamples.resize(count);
+	        size_t used = 0,
+	        	   rays = 0;
+	        for(unsigned int n = 0; n < count; ++n) {
+	        	LightSample& sample = lightSamples[used];
+	        	sample.origin = light.position;
+	        	if(n > 0) {
+	        		if(rays >= rayCap)
+	        			break;
+	        		float angle = float(n) * 2.0f * float(M_PI) / float(count - 1);
+	        		sample.origin += sf::Vector2f(light.sourceRadius * std::cos(angle), light.sourceRadius * std::sin(angle));
+	        		if((sample.origin.x < 0) || (sample.origin.y < 0))
+	        			continue;
+	        		sf::Vector3u tile(sample.origin.x / tilesize.x, sample.origin.y / tilesize.y, 0);
+	        		if((tile.x < targetWorld->getTilemapSize().x) && (tile.y < targetWorld->getTilemapSize().y) && physicsProperties->at(targetWorld->tile(tile)).tangible)
+	        			continue;
+	        	}
+	        	size_t left = (n == 0) ? size_t(-1) : (rayCap - rays), // The centre polygon is always cast
+	        		   before = left;
+	        	bool cast = calcLightPolygon(sample.origin, light.radius, bleed, sample.polygon, left);
+	        	rays += before - left;
+	        	if(!cast) {
+	        		if(n == 0)
+	        			break; // The light itself is outside of the world
+	        		continue;
+	        	}
+	        	++used;
+	        }
+	        lightSamples.resize(used);
+	        return rays;
+	    }
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::beginFrame() {
+	        if(targetWorld->getRenderTarget() != nullptr) {
+	        	const sf::View& view = targetWorld->getRenderTarget()->getView();
+	        	beginFrame(sf::Vector2f(view.getCenter().x - (view.getSize().x * 0.5f), view.getCenter().y - (view.getSize().y * 0.5f)), view.getSize());
+	        }
+	        else
+	        	beginFrame(viewPosition, viewSize);
+	    }
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::beginFrame(sf::Vector2f position, sf::Vector2f size) {
+	        // The scale only changes after many frames in a row, so a single slow frame doesn't make the lightmap flicker between sizes
+	        if(frameBudget > 0) {
+	        	float frameTime = frameClock.restart().asSeconds();
+	        	if(frameTime > frameBudget) {
+	        		fastFrames = 0;
+	        		if((++slowFrames >= 30) && (frameScale > 0.25f)) {
+	        			frameScale = std::max(frameScale * 0.5f, 0.25f);
+	        			slowFrames = 0;
+	        		}
+	        	}
+	        	else if(frameTime < frameBudget * 0.5f) {
+	        		slowFrames = 0;
+	        		if((++fastFrames >= 120) && (frameScale < scale)) {
+	        			frameScale = std::min(frameScale * 2, scale);
+	        			fastFrames = 0;
+	        		}
+	        	}
+	        	else {
+	        		slowFrames = fastFrames = 0;
+	        	}
+	        }
+
+	        viewSize = size;
+	        viewPosition = position;
+	        resizeLightmap();
+	        va.clear(); // Keeps its memory, so steady frames don't reallocate
+	    }
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::resizeLightmap() {
+	        sf::Vector2u size(ceil(viewSize.x * frameScale), ceil(viewSize.y * frameScale));
+	        backend->resize(size, frameScale);
+	    }
+
+		template< class worldTileIDType, typename IDType > unsigned long LightMap< worldTileIDType, IDType >::calcLightRevision(sf::Vector2f position, float radius) {
+	        // Rays stay inside the light's box, but the bitmask of a tile on its border also depends on the tiles just outside
+	        sf::Vector2u tilesize(targetWorld->getTileSize());
+	        long left = long(std::floor((position.x - radius) / tilesize.x)) - 1,
+	        	 top = long(std::floor((position.y - radius) / tilesize.y)) - 1,
+	        	 right = long(std::floor((position.x + radius) / tilesize.x)) + 1,
+	        	 bottom = long(std::floor((position.y + radius) / tilesize.y)) + 1;
+	        if((right < 0) || (bottom < 0))
+	        	return 0;
+	        return targetWorld->getRevision(sf::Vector2u(std::max(left, 0L), std::max(top, 0L)), sf::Vector2u(right, bottom));
+	    }
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::updateEdgeMesh(sf::Vector2f position, float radius) {
+	        // The tiles of the light's box, and the ones just past its right and bottom, which own the edges on those sides
+	        sf::Vector2u tilesize(targetWorld->getTileSize());
+	        long left = long(std::floor((position.x - radius) / tilesize.x)),
+	        	 top = long(std::floor((position.y - radius) / tilesize.y)),
+	        	 right = long(std::floor((position.x + radius) / tilesize.x)) + 1,
+	        	 bottom = long(std::floor((position.y + radius) / tilesize.y)) + 1;
+	        if((right >= 0) && (bottom >= 0))
+	        	edgeMesh.update(sf::Vector2u(std::max(left, 0L), std::max(top, 0L)), sf::Vector2u(right, bottom));
+	    }
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::updateLightPolygons() {
+	        // Find the stale lights first, so that the workers only touch their own cache entries
+	        staleLights.clear();
+	        for(IDType lightID : visibleLights) {
+	        	const PointLight& light = lightChunks[lightID];
+	        	size_t slot = lightChunks.slotOf(lightID);
+	        	if(slot >= lightCache.size())
+	        		lightCache.resize(slot + 1);
+	        	LightCache& cache = lightCache[slot];
+	        	float reach = light.radius + light.sourceRadius; // Samples are cast from anywhere on the source
+	        	unsigned long revision = calcLightRevision(light.position, reach);
+	        	if(cache.valid && (cache.position == light.position) && (cache.radius == light.radius) && (cache.bleed == bleed) && (cache.sourceRadius == light.sourceRadius) &&
+	        	   (cache.quality == light.quality) && (cache.revision == revision))
+	        		continue;
+	        	cache.position = light.position;
+	        	cache.radius = light.radius;
+	        	cache.bleed = bleed;
+	        	cache.sourceRadius = light.sourceRadius;
+	        	cache.quality = light.quality;
+	        	cache.revision = revision;
+	        	cache.valid = false; // Until the polygons are done, in case computing them throws
+	        	staleLights.push_back(lightID);
+	        	updateEdgeMesh(light.position, reach); // Here, so that the workers only read it
+	        }
+
+	        // Lights differ a lot in cost, so they are handed out one by one to whichever thread is free
+	        workers->run(0, staleLights.size(), [this](size_t begin, size_t end) {
+	        	for(size_t n = begin; n < end; ++n) {
+	        		LightCache& cache = lightCache[lightChunks.slotOf(staleLights[n])];
+	        		cache.rays = calcLightSamples(PointLight(cache.position, cache.radius, sf::Color::White, cache.sourceRadius, cache.quality), cache.bleed, cache.samples);
+	        		cache.valid = true;
+	        	}
+	        });
+	    }
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::appendLight(sf::Vector2f position, const std::vector< sf::Vector2f >& polygon, sf::Color color) {
+	        if(polygon.empty())
+	        	return;
+
+	        // The fan is written as separate triangles, so that all lights of the frame go in one vertex array and one draw call
+	        sf::Vector2u tilesize(targetWorld->getTileSize());
+	        sf::Vertex centre(sf::Vector2f(position.x - viewPosition.x, position.y - viewPosition.y), color),
+	        		   last(sf::Vector2f(polygon.back().x * tilesize.x - viewPosition.x, polygon.back().y * tilesize.y - viewPosition.y), color);
+	        for(size_t n = 0; n < polygon.size(); ++n) {
+	        	sf::Vertex next(sf::Vector2f(polygon[n].x * tilesize.x - viewPosition.x, polygon[n].y * tilesize.y - viewPosition.y), color);
+	        	va.append(centre);
+	        	va.append(last);
+	        	va.append(next);
+	        	last = next;
+	        }
+	    }
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::appendLight(const std::vector< LightSample >& lightSamples, sf::Color color) {
+	        // Sample n gets color * (n + 1) / count - color * n / count, so the shares add up to exactly color. Alpha isn't split, since BlendAdd scales by it.
+	        size_t count = lightSamples.size();
+	        for(size_t n = 0; n < count; ++n) {
+	        	sf::Color share((color.r * (n + 1) / count) - (color.r * n / count),
+	        					(color.g * (n + 1) / count) - (color.g * n / count),
+	        					(color.b * (n + 1) / count) - (color.b * n / count),
+	        					color.a);
+	        	appendLight(lightSamples[n].origin, lightSamples[n].polygon, share);
 	        }
+	    }
 
-	        std::sort(points.begin(), points.end(), [&oX, &oY](sf::Vector2f a, sf::Vector2f b) { return atan2(a.y - oY, a.x - oX) < atan2(b.y - oY, b.x - oX); });
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::submit(sf::Vector2f position, float radius, float bleed, sf::Color color) {
+	        submit(PointLight(position, radius, color), bleed);
+	    }
 
-	        sf::Vector2f centre(targetWorld->getRenderTarget()->getView().getCenter()),
-	        			 viewPos(centre.x - (viewSize.x * 0.5f), centre.y - (viewSize.y * 0.5f));
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::submit(const PointLight& light, float bleed) {
+	        updateEdgeMesh(light.position, light.radius + light.sourceRadius);
+	        calcLightSamples(light, bleed, samples);
+	        appendLight(samples, light.color);
+	    }
 
-	        va.clear();
-	        va.append(sf::Vertex(sf::Vector2f(position.x - viewPos.x, position.y - viewPos.y)));
-	        for(size_t n = 0; n < points.size(); ++n)
-	        	va.append(sf::Vertex(sf::Vector2f(points[n].x * tilesize.x - viewPos.x, points[n].y * tilesize.y - viewPos.y)));
-	        va.append(sf::Vertex(sf::Vector2f(points[0].x * tilesize.x - viewPos.x, points[0].y * tilesize.y - viewPos.y)));
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::resolve() {
+	        resolve(targetWorld->getRenderTarget());
+	    }
 
-	        lightmap.clear(sf::Color(64, 64, 64));
-	        lightmap.draw(va);
-	        lightmap.display();
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::resolve(sf::RenderTarget* target) {
+	        // Lights add up where they overlap. Only the area the lights cover is filled, apart from the clear and the composite.
+	        backend->accumulate(va, ambientColor);
+	        if(target != nullptr)
+	        	backend->composite(*target, viewPosition);
+	    }
 
-	        sf::Sprite lightmapSpr(lightmap.getTexture());
-	        lightmapSpr.setPosition(viewPos);
-	        targetWorld->getRenderTarget()->draw(lightmapSpr, sf::RenderStates(sf::BlendMultiply));
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::renderLight(sf::Vector2f position, float radius, float bleed) {
+	        beginFrame();
+	        submit(position, radius, bleed);
+	        resolve();
 	    }
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setScale(float lightmapScale) {
+			scale = frameScale = lightmapScale;
+			slowFrames = fastFrames = 0;
+		}
+
+		template< class worldTileIDType, typename IDType > float LightMap< worldTileIDType, IDType >::getScale() {
+			return scale;
+		}
+
+		template< class worldTileIDType, typename IDType > float LightMap< worldTileIDType, IDType >::getFrameScale() {
+			return frameScale;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setFrameBudget(float seconds) {
+			frameBudget = seconds;
+			frameScale = scale;
+			slowFrames = fastFrames = 0;
+			frameClock.restart();
+		}
+
+		template< class worldTileIDType, typename IDType > float LightMap< worldTileIDType, IDType >::getFrameBudget() {
+			return frameBudget;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setAmbientColor(sf::Color color) {
+			ambientColor = color;
+		}
+
+		template< class worldTileIDType, typename IDType > sf::Color LightMap< worldTileIDType, IDType >::getAmbientColor() {
+			return ambientColor;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::render(sf::Vector2f tlScreenPoint, sf::Vector2f brScreenPoint) {
+			// Screen points are in tiles, like in World::render
+			sf::Vector2u tilesize(targetWorld->getTileSize());
+			float left = tlScreenPoint.x * tilesize.x,
+				  top = tlScreenPoint.y * tilesize.y,
+				  right = (brScreenPoint.x + 1) * tilesize.x,
+				  bottom = (brScreenPoint.y + 1) * tilesize.y;
+
+			// The lights whose box overlaps the view, then every light found is checked against its circle
+			visibleLights.clear();
+			lightChunks.query(sf::Vector2f(left, top), sf::Vector2f(right, bottom), visibleLights);
+
+			size_t visible = 0;
+			for(IDType lightID : visibleLights) {
+				const PointLight& light = lightChunks[lightID];
+				float distX = light.position.x - std::min(std::max(light.position.x, left), right), // Distance to the closest point of the view
+					  distY = light.position.y - std::min(std::max(light.position.y, top), bottom);
+				float reach = light.radius + light.sourceRadius;
+				if((distX * distX) + (distY * distY) <= reach * reach)
+					visibleLights[visible++] = lightID;
+			}
+			visibleLights.resize(visible);
+			updateLightPolygons();
+
+			if(targetWorld->getRenderTarget() != nullptr)
+				beginFrame();
+			else
+				beginFrame(sf::Vector2f(left, top), sf::Vector2f(right - left, bottom - top)); // Nothing to take the view from, so the lightmap covers the screen points
+			for(IDType lightID : visibleLights) {
+				const PointLight& light = lightChunks[lightID];
+				appendLight(lightCache[lightChunks.slotOf(lightID)].samples, light.color);
+			}
+			resolve();
+		}
+
+		template< class worldTileIDType, typename IDType > IDType LightMap< worldTileIDType, IDType >::addLight(const PointLight& light) {
+			float reach = light.radius + light.sourceRadius;
+			return lightChunks.add(light, light.position, sf::Vector2f(reach, reach));
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::moveLight(IDType lightID, sf::Vector2f position) {
+			lightChunks.move(lightID, position);
+			lightChunks[lightID].position = position;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setLightRadius(IDType lightID, float radius) {
+			PointLight& light = lightChunks[lightID];
+			light.radius = radius;
+			lightChunks.resize(lightID, sf::Vector2f(radius + light.sourceRadius, radius + light.sourceRadius));
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setLightColor(IDType lightID, sf::Color color) {
+			lightChunks[lightID].color = color;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setLightSourceRadius(IDType lightID, float sourceRadius) {
+			PointLight& light = lightChunks[lightID];
+			light.sourceRadius = sourceRadius;
+			lightChunks.resize(lightID, sf::Vector2f(light.radius + sourceRadius, light.radius + sourceRadius));
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setLightQuality(IDType lightID, unsigned int quality) {
+			lightChunks[lightID].quality = quality;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::removeLight(IDType lightID) {
+			lightChunks.remove(lightID);
+			size_t slot = lightChunks.slotOf(lightID);
+			if(slot < lightCache.size())
+				lightCache[slot] = LightCache(); // Frees the polygons. The slot may be reused by a new light.
+		}
+
+		template< class worldTileIDType, typename IDType > const PointLight& LightMap< worldTileIDType, IDType >::getLight(IDType lightID) {
+			return lightChunks[lightID];
+		}
+
+		template< class worldTileIDType, typename IDType > size_t LightMap< worldTileIDType, IDType >::getLightCount() {
+			return lightChunks.size();
+		}
+
+		template< class worldTileIDType, typename IDType > size_t LightMap< worldTileIDType, IDType >::getLightRays(IDType lightID) {
+			size_t slot = lightChunks.slotOf(lightID);
+			return (slot < lightCache.size()) ? lightCache[slot].rays : 0;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setBleed(float lightBleed) {
+			bleed = lightBleed;
+		}
+
+		template< class worldTileIDType, typename IDType > float LightMap< worldTileIDType, IDType >::getBleed() {
+			return bleed;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::clearLightCache() {
+			for(LightCache& cache : lightCache)
+				cache.valid = false;
+			edgeMesh.clear();
+			buildTileEdges();
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setThreadCount(size_t threads) {
+			workers.reset(); // Join the old threads before starting new ones
+			workers.reset(new WorkerPool(threads));
+		}
+
+		template< class worldTileIDType, typename IDType > size_t LightMap< worldTileIDType, IDType >::getThreadCount() {
+			return workers->getThreadCount();
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setEngine(LightEngine lightEngine) {
+			engine = lightEngine;
+			clearLightCache();
+		}
+
+		template< class worldTileIDType, typename IDType > LightEngine LightMap< worldTileIDType, IDType >::getEngine() {
+			return engine;
+		}
+
+		template< class worldTileIDType, typename IDType > void LightMap< worldTileIDType, IDType >::setRayCap(size_t cap) {
+			rayCap = cap;
+			clearLightCache();
+		}
+
+		template< class worldTileIDType, typename IDType > size_t LightMap< worldTileIDType, IDType >::getRayCap() {
+			return rayCap;
+		}
+
+		template< class worldTileIDType, typename IDType > LightBackend* LightMap< worldTileIDType, IDType >::getBackend() {
+			return backend.get();
+		}
 }
 
 #endif
\ No newline at end of file
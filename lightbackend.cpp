@@ -0,0 +1,207 @@
+#include "lightbackend.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace sfte {
+	// sfte::RenderTextureLightBackend implementation
+		void RenderTextureLightBackend::resize(sf::Vector2u size, float lightmapScale) {
+			if(lightmap.getSize() != size) {
+				lightmap.create(size.x, size.y);
+				lightmap.setSmooth(true); // Bilinear upsampling when it is composited
+			}
+			// Triangles are in view pixels whatever the lightmap's size, and one of its pixels is 1 / scale of them
+			scale = lightmapScale;
+			sf::Vector2f area(size.x / scale, size.y / scale);
+			lightmap.setView(sf::View(sf::Vector2f(area.x * 0.5f, area.y * 0.5f), area));
+		}
+
+		sf::Vector2u RenderTextureLightBackend::getSize() const {
+			return lightmap.getSize();
+		}
+
+		void RenderTextureLightBackend::accumulate(const sf::VertexArray& triangles, sf::Color ambient) {
+			lightmap.clear(ambient);
+			if(triangles.getVertexCount() > 0)
+				lightmap.draw(triangles, sf::RenderStates(sf::BlendAdd));
+			lightmap.display();
+		}
+
+		void RenderTextureLightBackend::composite(sf::RenderTarget& target, sf::Vector2f position) {
+			sf::Sprite lightmapSpr(lightmap.getTexture());
+			lightmapSpr.setPosition(position);
+			lightmapSpr.setScale(1 / scale, 1 / scale);
+			target.draw(lightmapSpr, sf::RenderStates(sf::BlendMultiply));
+		}
+
+		const sf::Texture& RenderTextureLightBackend::getTexture() const {
+			return lightmap.getTexture();
+		}
+
+	// sfte::SoftwareLightBackend implementation
+		namespace {
+			// x where the edge from p to q crosses the row centre y. Only called for p.y <= y < q.y.
+			float edgeX(sf::Vector2f p, sf::Vector2f q, float y) {
+				return p.x + ((y - p.y) * (q.x - p.x) / (q.y - p.y));
+			}
+
+			bool above(sf::Vector2f a, sf::Vector2f b) {
+				return (a.y != b.y) ? (a.y < b.y) : (a.x < b.x);
+			}
+
+			void addSpan(std::uint8_t* row, unsigned int begin, unsigned int end, std::uint32_t color) {
+				unsigned int x = begin;
+#if defined(__SSE2__) || defined(_M_X64)
+				// 4 pixels at a time, with a saturating add per channel
+				const __m128i add = _mm_set1_epi32(int(color));
+				for(; x + 4 <= end; x += 4) {
+					__m128i* span = reinterpret_cast< __m128i* >(row + (x * 4));
+					_mm_storeu_si128(span, _mm_adds_epu8(_mm_loadu_si128(span), add));
+				}
+#endif
+				// What's left, or everything without SIMD
+				for(; x < end; ++x) {
+					for(unsigned int channel = 0; channel < 4; ++channel) {
+						unsigned int sum = row[(x * 4) + channel] + ((color >> (channel * 8)) & 0xFF);
+						row[(x * 4) + channel] = (sum > 255) ? 255 : sum;
+					}
+				}
+			}
+		}
+
+		void SoftwareLightBackend::rasterizeBand(size_t band) {
+			unsigned int rowBegin = band * bandHeight,
+						 rowEnd = std::min(size.y, rowBegin + bandHeight);
+			for(size_t index : bins[band]) {
+				const Triangle& triangle = triangles[index];
+				// Rows whose centre is in [top.y, bottom.y)
+				long first = std::max(long(std::ceil(triangle.top.y - 0.5f)), long(rowBegin)),
+					 last = std::min(long(std::ceil(triangle.bottom.y - 0.5f)), long(rowEnd));
+				for(long y = first; y < last; ++y) {
+					float centreY = y + 0.5f,
+						  longX = edgeX(triangle.top, triangle.bottom, centreY),
+						  shortX = (centreY < triangle.middle.y) ? edgeX(triangle.top, triangle.middle, centreY) : edgeX(triangle.middle, triangle.bottom, centreY);
+					// Pixels whose centre is in [left, right)
+					long left = std::max(long(std::ceil(std::min(longX, shortX) - 0.5f)), 0L),
+						 right = std::min(long(std::ceil(std::max(longX, shortX) - 0.5f)), long(size.x));
+					if(left < right)
+						addSpan(&pixels[size_t(y) * size.x * 4], left, right, triangle.color);
+				}
+			}
+		}
+
+		void SoftwareLightBackend::resize(sf::Vector2u lightmapSize, float lightmapScale) {
+			if(size != lightmapSize) {
+				size = lightmapSize;
+				pixels.assign(size_t(size.x) * size.y * 4, 0);
+				bins.resize((size.y + bandHeight - 1) / bandHeight);
+			}
+			scale = lightmapScale;
+		}
+
+		sf::Vector2u SoftwareLightBackend::getSize() const {
+			return size;
+		}
+
+		void SoftwareLightBackend::accumulate(const sf::VertexArray& vertices, sf::Color ambient) {
+			// Clear
+			std::uint32_t clearColor = std::uint32_t(ambient.r) | (std::uint32_t(ambient.g) << 8) | (std::uint32_t(ambient.b) << 16) | (std::uint32_t(255) << 24);
+			workers->run(0, bins.size(), [this, clearColor](size_t bandBegin, size_t bandEnd) {
+				size_t begin = bandBegin * bandHeight * size.x,
+					   end = std::min(bandEnd * bandHeight, size_t(size.y)) * size.x;
+				std::fill(reinterpret_cast< std::uint32_t* >(pixels.data()) + begin, reinterpret_cast< std::uint32_t* >(pixels.data()) + end, clearColor);
+			}, 4);
+
+			// Triangles to pixels, and into the bins of the bands they touch
+			triangles.clear();
+			for(std::vector< size_t >& bin : bins)
+				bin.clear();
+			for(size_t n = 0; n + 3 <= vertices.getVertexCount(); n += 3) {
+				Triangle triangle;
+				sf::Vector2f corners[3];
+				for(size_t corner = 0; corner < 3; ++corner)
+					corners[corner] = sf::Vector2f(vertices[n + corner].position.x * scale, vertices[n + corner].position.y * scale);
+				std::sort(corners, corners + 3, above);
+				triangle.top = corners[0];
+				triangle.middle = corners[1];
+				triangle.bottom = corners[2];
+				const sf::Color& color = vertices[n].color;
+				triangle.color = std::uint32_t(color.r * color.a / 255) | (std::uint32_t(color.g * color.a / 255) << 8) | (std::uint32_t(color.b * color.a / 255) << 16);
+
+				long firstBand = std::max(long(std::ceil(triangle.top.y - 0.5f)), 0L) / long(bandHeight),
+					 lastBand = std::min(long(std::ceil(triangle.bottom.y - 0.5f)) - 1, long(size.y) - 1) / long(bandHeight);
+				if((triangle.bottom.y <= 0) || (lastBand < firstBand))
+					continue;
+				for(long band = firstBand; band <= lastBand; ++band)
+					bins[band].push_back(triangles.size());
+				triangles.push_back(triangle);
+			}
+
+			// Every band only writes its own rows, so they don't need to be synchronised
+			workers->run(0, bins.size(), [this](size_t bandBegin, size_t bandEnd) {
+				for(size_t band = bandBegin; band < bandEnd; ++band)
+					rasterizeBand(band);
+			});
+		}
+
+		void SoftwareLightBackend::composite(sf::RenderTarget& target, sf::Vector2f position) {
+			if(!present)
+				return;
+			if(!texture)
+				texture.reset(new sf::Texture());
+			if(texture->getSize() != size) {
+				texture->create(size.x, size.y);
+				texture->setSmooth(true);
+			}
+			texture->update(pixels.data());
+			sf::Sprite lightmapSpr(*texture);
+			lightmapSpr.setPosition(position);
+			lightmapSpr.setScale(1 / scale, 1 / scale);
+			target.draw(lightmapSpr, sf::RenderStates(sf::BlendMultiply));
+		}
+
+		const std::uint8_t* SoftwareLightBackend::getPixels() const {
+			return pixels.data();
+		}
+
+		void SoftwareLightBackend::copyToImage(sf::Image& image) const {
+			image.create(size.x, size.y, pixels.data());
+		}
+
+		void SoftwareLightBackend::compositeImage(sf::Image& scene) {
+			if(pixels.empty())
+				return;
+			sf::Vector2u sceneSize(scene.getSize());
+			std::vector< std::uint8_t > out(size_t(sceneSize.x) * sceneSize.y * 4);
+			const std::uint8_t* in = scene.getPixelsPtr();
+			workers->run(0, sceneSize.y, [this, &out, in, sceneSize](size_t rowBegin, size_t rowEnd) {
+				for(size_t y = rowBegin; y < rowEnd; ++y) {
+					// Sample between the four nearest lightmap pixels, like a smooth texture does
+					float v = std::min(std::max(((y + 0.5f) * scale) - 0.5f, 0.0f), float(size.y - 1));
+					unsigned int y0 = unsigned(v),
+								 y1 = std::min(y0 + 1, size.y - 1);
+					float fy = v - y0;
+					for(size_t x = 0; x < sceneSize.x; ++x) {
+						float u = std::min(std::max(((x + 0.5f) * scale) - 0.5f, 0.0f), float(size.x - 1));
+						unsigned int x0 = unsigned(u),
+									 x1 = std::min(x0 + 1, size.x - 1);
+						float fx = u - x0;
+						size_t pixel = ((y * sceneSize.x) + x) * 4;
+						for(unsigned int channel = 0; channel < 3; ++channel) {
+							float top = (pixels[(((size_t(y0) * size.x) + x0) * 4) + channel] * (1 - fx)) + (pixels[(((size_t(y0) * size.x) + x1) * 4) + channel] * fx),
+								  bottom = (pixels[(((size_t(y1) * size.x) + x0) * 4) + channel] * (1 - fx)) + (pixels[(((size_t(y1) * size.x) + x1) * 4) + channel] * fx),
+								  light = (top * (1 - fy)) + (bottom * fy);
+							out[pixel + channel] = std::uint8_t((in[pixel + channel] * light / 255.0f) + 0.5f);
+						}
+						out[pixel + 3] = in[pixel + 3];
+					}
+				}
+			}, 16);
+			scene.create(sceneSize.x, sceneSize.y, out.data());
+		}
+
+		SoftwareLightBackend::SoftwareLightBackend(size_t threads, bool drawToTarget) :
+			workers(new WorkerPool(threads)),
+			present(drawToTarget)
+		{ }
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef SFTE_LIGHTBACKEND_HPP
+#define SFTE_LIGHTBACKEND_HPP
+
+#include <memory>
+#include <cstdint>
+#include "core.hpp"
+#include "parallel.hpp"
+
+namespace sfte {
+	class LightBackend { // Where LightMap adds up the light of a frame, and how the result is put on the screen.
+	public:
+		virtual void resize(sf::Vector2u size, float scale) = 0; // size in pixels, scale = lightmap pixels per view pixel. Called every frame.
+		virtual sf::Vector2u getSize() const = 0;
+		virtual void accumulate(const sf::VertexArray& triangles, sf::Color ambient) = 0; // Clear to ambient, then add triangles, which are in view pixels
+		virtual void composite(sf::RenderTarget& target, sf::Vector2f position) = 0; // Multiply target by the lightmap, with its top left at position
+		virtual ~LightBackend() {}
+	};
+
+	class RenderTextureLightBackend : public LightBackend { // On the GPU, with a sf::RenderTexture. What LightMap uses by default.
+		sf::RenderTexture lightmap;
+		float scale = 1;
+	public:
+		void resize(sf::Vector2u size, float lightmapScale) override;
+		sf::Vector2u getSize() const override;
+		void accumulate(const sf::VertexArray& triangles, sf::Color ambient) override;
+		void composite(sf::RenderTarget& target, sf::Vector2f position) override;
+		const sf::Texture& getTexture() const;
+	};
+
+	/*
+	On the CPU, for machines without OpenGL, and for baking lightmaps offline. Triangles are filled into an RGBA buffer with
+	saturating adds, like BlendAdd does, in bands of rows spread over a worker pool. Triangles are flat, with the colour of their
+	first vertex, which is what LightMap makes. Pixels are covered when their centre is, with half open edges, so the triangles of a
+	fan never add the same pixel twice.
+	*/
+	class SoftwareLightBackend : public LightBackend {
+		struct Triangle {
+			sf::Vector2f top, middle, bottom;	// In pixels, sorted by y then x, so an edge shared by two triangles is computed the same way in both.
+			std::uint32_t color;				// RGBA packed like the buffer, already multiplied by its alpha. Alpha is 0, so it isn't added.
+		};
+
+		std::vector< std::uint8_t > pixels;		// RGBA, row major, like sf::Image.
+		sf::Vector2u size;
+		float scale = 1;
+		std::vector< Triangle > triangles;		// Of the frame being accumulated.
+		std::vector< std::vector< size_t > > bins; // Triangles touching each band of rows.
+		std::unique_ptr< WorkerPool > workers;
+		bool present;							// Also draw the lightmap onto the target in composite. Needs OpenGL.
+		std::unique_ptr< sf::Texture > texture;	// The lightmap uploaded for present. Made by the first composite which presents, so nothing else needs OpenGL.
+
+		void rasterizeBand(size_t band);
+	public:
+		static const unsigned int bandHeight = 16;
+
+		void resize(sf::Vector2u lightmapSize, float lightmapScale) override;
+		sf::Vector2u getSize() const override;
+		void accumulate(const sf::VertexArray& triangles, sf::Color ambient) override;
+		void composite(sf::RenderTarget& target, sf::Vector2f position) override;
+
+		// Reading the lightmap back, which needs neither a render target nor OpenGL
+		const std::uint8_t* getPixels() const;
+		void copyToImage(sf::Image& image) const;	// The lightmap itself, to bake it
+		void compositeImage(sf::Image& scene);		// Multiply scene, which is the size of the view, by the lightmap upsampled bilinearly. What composite shows on the GPU.
+
+		SoftwareLightBackend(size_t threads = 0, bool drawToTarget = false); // 0 threads = workerCount()
+	};
+}
+
+#endif
\ No newline at end of file
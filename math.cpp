@@ -1,4 +1,9 @@
 #include "math.hpp"
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 void sfte::extendRayToBounds(float x1, float y1, float &x2, float &y2, float m, float c, float leftB, float upB, float rightB, float downB) {
 	/*
@@ -184,4 +189,148 @@ void sfte::extendRayCircle(float x1, float y1, float &x2, float &y2, float a, fl
 	
 	if(snapToBounds)
 		extendRayToBounds(x1, y1, x2, y2, m, c, leftB, upB, rightB, downB);
+}
+
+float sfte::pseudoAngle(float dx, float dy) {
+	/*
+	Goes around the unit diamond instead of the unit circle, so it is monotonic in the angle but only needs a division.
+	r is where the direction hits the diamond on the x axis, from 1 (right) to -1 (left). Above the x axis (dy >= 0) that
+	maps to 0..2 like atan2 gives 0..pi, below it to -2..0 like atan2 gives -pi..0.
+	*/
+	if((dx == 0) && (dy == 0))
+		return 0; // Like atan2(0, 0), rather than 0 / 0
+	float r = dx / (fabs(dx) + fabs(dy));
+	return (dy >= 0) ? (1 - r) : (r - 1);
+}
+
+// sfte::EdgeArrays implementation
+void sfte::EdgeArrays::add(bool x, float a, float s, float b) {
+	std::vector< float > &arrayA = x ? xA : yA,
+						 &arrayS = x ? xS : yS,
+						 &arrayB = x ? xB : yB;
+	size_t& count = x ? xCount : yCount;
+	if(count == arrayA.size()) { // Pad with s > b, which no crossing is between
+		arrayA.resize(count + padding, 0);
+		arrayS.resize(count + padding, INFINITY);
+		arrayB.resize(count + padding, -INFINITY);
+	}
+	arrayA[count] = a;
+	arrayS[count] = s;
+	arrayB[count] = b;
+	++count;
+}
+
+void sfte::EdgeArrays::clear() {
+	xA.clear();
+	xS.clear();
+	xB.clear();
+	yA.clear();
+	yS.clear();
+	yB.clear();
+	xCount = yCount = 0;
+}
+
+namespace {
+	/*
+	Nearest crossing of the edges along one axis, kept per SIMD lane. t = (a - pointA) * invA is where the line reaches an edge's
+	line as a multiple of the direction, pointS + t * dirS where along the edge it does. A line parallel to the edges gives an
+	infinite or NaN t, and padding has s > b, both of which fail every comparison.
+	*/
+#if defined(__AVX__)
+	void nearestAxisHit(const float* a, const float* s, const float* b, size_t count, float pointA, float pointS, float invA, float dirS, float from, __m256& best, __m256& bestSq) {
+		const __m256 pA = _mm256_set1_ps(pointA),
+					 pS = _mm256_set1_ps(pointS),
+					 inv = _mm256_set1_ps(invA),
+					 dS = _mm256_set1_ps(dirS),
+					 f = _mm256_set1_ps(from);
+		for(size_t i = 0; i < count; i += 8) {
+			__m256 t = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(a + i), pA), inv),
+				   cross = _mm256_add_ps(pS, _mm256_mul_ps(t, dS)),
+				   u = _mm256_sub_ps(t, f),
+				   uSq = _mm256_mul_ps(u, u),
+				   nearer = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(cross, _mm256_loadu_ps(s + i), _CMP_GE_OQ), _mm256_cmp_ps(cross, _mm256_loadu_ps(b + i), _CMP_LE_OQ)),
+										  _mm256_and_ps(_mm256_cmp_ps(u, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(uSq, bestSq, _CMP_LT_OQ)));
+			best = _mm256_blendv_ps(best, t, nearer);
+			bestSq = _mm256_blendv_ps(bestSq, uSq, nearer);
+		}
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	void nearestAxisHit(const float* a, const float* s, const float* b, size_t count, float pointA, float pointS, float invA, float dirS, float from, __m128& best, __m128& bestSq) {
+		const __m128 pA = _mm_set1_ps(pointA),
+					 pS = _mm_set1_ps(pointS),
+					 inv = _mm_set1_ps(invA),
+					 dS = _mm_set1_ps(dirS),
+					 f = _mm_set1_ps(from);
+		for(size_t i = 0; i < count; i += 4) {
+			__m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(a + i), pA), inv),
+				   cross = _mm_add_ps(pS, _mm_mul_ps(t, dS)),
+				   u = _mm_sub_ps(t, f),
+				   uSq = _mm_mul_ps(u, u),
+				   nearer = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(cross, _mm_loadu_ps(s + i)), _mm_cmple_ps(cross, _mm_loadu_ps(b + i))),
+									   _mm_and_ps(_mm_cmpge_ps(u, _mm_setzero_ps()), _mm_cmplt_ps(uSq, bestSq)));
+			best = _mm_or_ps(_mm_and_ps(nearer, t), _mm_andnot_ps(nearer, best));
+			bestSq = _mm_or_ps(_mm_and_ps(nearer, uSq), _mm_andnot_ps(nearer, bestSq));
+		}
+	}
+#else
+	void nearestAxisHit(const float* a, const float* s, const float* b, size_t count, float pointA, float pointS, float invA, float dirS, float from, float& best, float& bestSq) {
+		for(size_t i = 0; i < count; ++i) {
+			float t = (a[i] - pointA) * invA,
+				  cross = pointS + (t * dirS),
+				  u = t - from;
+			if((cross >= s[i]) && (cross <= b[i]) && (u >= 0) && ((u * u) < bestSq)) {
+				best = t;
+				bestSq = u * u;
+			}
+		}
+	}
+#endif
+}
+
+bool sfte::nearestEdgeHit(sf::Vector2f point, sf::Vector2f direction, float from, const EdgeArrays& edges, float& hit) {
+	// Only crossings at or after from count, so the ray never hits an edge behind where it starts. Past from, the distance to a
+	// crossing is (t - from) * |direction|, so comparing (t - from)^2 compares squared distances.
+	// The arrays are padded to a whole number of registers, so there are no leftover edges.
+	float invX = 1.0f / direction.x,
+		  invY = 1.0f / direction.y,
+		  best = 0,
+		  bestSq = INFINITY;
+#if defined(__AVX__)
+	__m256 laneBest = _mm256_setzero_ps(),
+		   laneBestSq = _mm256_set1_ps(INFINITY);
+	nearestAxisHit(edges.xA.data(), edges.xS.data(), edges.xB.data(), edges.xA.size(), point.x, point.y, invX, direction.y, from, laneBest, laneBestSq);
+	nearestAxisHit(edges.yA.data(), edges.yS.data(), edges.yB.data(), edges.yA.size(), point.y, point.x, invY, direction.x, from, laneBest, laneBestSq);
+	float lanes[8],
+		  lanesSq[8];
+	_mm256_storeu_ps(lanes, laneBest);
+	_mm256_storeu_ps(lanesSq, laneBestSq);
+	for(size_t lane = 0; lane < 8; ++lane) {
+		if(lanesSq[lane] < bestSq) {
+			best = lanes[lane];
+			bestSq = lanesSq[lane];
+		}
+	}
+#elif defined(__SSE2__) || defined(_M_X64)
+	__m128 laneBest = _mm_setzero_ps(),
+		   laneBestSq = _mm_set1_ps(INFINITY);
+	nearestAxisHit(edges.xA.data(), edges.xS.data(), edges.xB.data(), edges.xA.size(), point.x, point.y, invX, direction.y, from, laneBest, laneBestSq);
+	nearestAxisHit(edges.yA.data(), edges.yS.data(), edges.yB.data(), edges.yA.size(), point.y, point.x, invY, direction.x, from, laneBest, laneBestSq);
+	float lanes[4],
+		  lanesSq[4];
+	_mm_storeu_ps(lanes, laneBest);
+	_mm_storeu_ps(lanesSq, laneBestSq);
+	for(size_t lane = 0; lane < 4; ++lane) {
+		if(lanesSq[lane] < bestSq) {
+			best = lanes[lane];
+			bestSq = lanesSq[lane];
+		}
+	}
+#else
+	nearestAxisHit(edges.xA.data(), edges.xS.data(), edges.xB.data(), edges.xA.size(), point.x, point.y, invX, direction.y, from, best, bestSq);
+	nearestAxisHit(edges.yA.data(), edges.yS.data(), edges.yB.data(), edges.yA.size(), point.y, point.x, invY, direction.x, from, best, bestSq);
+#endif
+	if(bestSq == INFINITY)
+		return false;
+	hit = best;
+	return true;
 }
\ No newline at end of file
@@ -7,6 +7,29 @@ namespace sfte {
 	void extendRayToBounds(float x1, float y1, float &x2, float &y2, float m, float c, float leftB, float upB, float rightB, float downB);
 	void extendRaySquare(float x1, float y1, float &x2, float &y2, float a, float m, float c, float leftB, float upB, float rightB, float downB);
 	void extendRayCircle(float x1, float y1, float &x2, float &y2, float a, float m, float c, float leftB, float upB, float rightB, float downB);
+	float pseudoAngle(float dx, float dy); // Orders directions like atan2(dy, dx) does, without trigonometry. In (-2, 2]; opposite directions are 2 apart. 0 for no direction, like atan2(0, 0).
+
+	struct EdgeArrays { // Axis aligned edges as a structure of arrays, for nearestEdgeHit. Each array is padded with edges nothing can hit to a multiple of padding.
+#if defined(__AVX__)
+		static const size_t padding = 8; // Floats in a SIMD register, so nearestEdgeHit has no leftover edges
+#elif defined(__SSE2__) || defined(_M_X64)
+		static const size_t padding = 4;
+#else
+		static const size_t padding = 1;
+#endif
+		std::vector< float > xA, xS, xB,	// x aligned (| shape) edges: x, and their start and end in y
+							 yA, yS, yB;	// y aligned (- shape) edges: y, and their start and end in x
+		size_t xCount = 0,					// Edges added, without the padding
+			   yCount = 0;
+
+		void add(bool x, float a, float s, float b); // Same meaning as in pb::Edge
+		void clear();
+	};
+
+	// First edge crossed by the ray which starts at point + (from * direction) and goes along direction. Crossings behind its start
+	// are ignored. hit is where it is crossed, as point + (hit * direction). Crossings are computed from point, so one at point is
+	// exact. false if no edge is crossed.
+	bool nearestEdgeHit(sf::Vector2f point, sf::Vector2f direction, float from, const EdgeArrays& edges, float& hit);
 }
 
 #endif
\ No newline at end of file
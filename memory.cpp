@@ -0,0 +1,132 @@
+#include "memory.hpp"
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+
+#ifdef SFTE_COUNT_ALLOCATIONS
+static std::atomic< size_t > allocations(0);
+
+// Replacements of the global allocation functions, which count and forward to malloc. The aligned ones are left alone, as the
+// standard library implements them without the plain operator new.
+void* operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	for(;;) {
+		if(void* pointer = std::malloc((size == 0) ? 1 : size))
+			return pointer;
+		std::new_handler handler = std::get_new_handler();
+		if(handler == nullptr)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	}
+	catch(...) {
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+	std::free(pointer);
+}
+#endif
+
+size_t sfte::allocationCount() {
+#ifdef SFTE_COUNT_ALLOCATIONS
+	return allocations.load(std::memory_order_relaxed);
+#else
+	return 0;
+#endif
+}
+
+bool sfte::countingAllocations() {
+#ifdef SFTE_COUNT_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+// sfte::FrameArena implementation
+void* sfte::FrameArena::allocate(size_t bytes, size_t alignment) {
+	if(block < blocks.size()) {
+		std::uintptr_t base = reinterpret_cast< std::uintptr_t >(blocks[block].get());
+		size_t start = ((base + offset + alignment - 1) & ~std::uintptr_t(alignment - 1)) - base;
+		if(start + bytes <= blockSizes[block]) {
+			used += start + bytes - offset;
+			offset = start + bytes;
+			return blocks[block].get() + start;
+		}
+	}
+
+	// Full, so go on in a new block twice as big, which leaves room for the alignment
+	size_t size = std::max(std::max(bytes + alignment, size_t(4096)), blockSizes.empty() ? size_t(0) : blockSizes.back() * 2);
+	blocks.emplace_back(new unsigned char[size]);
+	blockSizes.push_back(size);
+	block = blocks.size() - 1;
+	offset = 0;
+	return allocate(bytes, alignment);
+}
+
+void sfte::FrameArena::reset() {
+	if(blocks.size() > 1) {
+		size_t capacity = getCapacity();
+		blocks.clear();
+		blockSizes.clear();
+		blocks.emplace_back(new unsigned char[capacity]);
+		blockSizes.push_back(capacity);
+	}
+	block = 0;
+	offset = 0;
+	used = 0;
+}
+
+size_t sfte::FrameArena::getUsed() const {
+	return used;
+}
+
+size_t sfte::FrameArena::getCapacity() const {
+	size_t capacity = 0;
+	for(size_t size : blockSizes)
+		capacity += size;
+	return capacity;
+}
+
+sfte::FrameArena::FrameArena(size_t initialCapacity) {
+	if(initialCapacity > 0) {
+		blocks.emplace_back(new unsigned char[initialCapacity]);
+		blockSizes.push_back(initialCapacity);
+	}
+}
\ No newline at end of file
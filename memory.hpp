@@ -0,0 +1,91 @@
+#ifndef SFTE_MEMORY_HPP
+#define SFTE_MEMORY_HPP
+
+#include <memory>
+#include <cstddef>
+#include <type_traits>
+#include "core.hpp"
+
+namespace sfte {
+	// Heap allocations made through the global operator new since the program started, by every thread. Only counted when sfte is
+	// built with SFTE_COUNT_ALLOCATIONS defined, which replaces the global operator new and delete. Otherwise always 0.
+	// Meant to be compared before and after a frame, to check that steady frames don't allocate.
+	size_t allocationCount();
+	bool countingAllocations(); // Whether sfte was built with SFTE_COUNT_ALLOCATIONS
+
+	class FrameArena { // Linear allocator for memory which only lives until the next reset, which is done once a frame by its owner
+		std::vector< std::unique_ptr< unsigned char[] > > blocks;
+		std::vector< size_t > blockSizes;
+		size_t block = 0,	// Block being allocated from
+			   offset = 0,	// in it.
+			   used = 0;	// Bytes handed out since the last reset, padding included.
+	public:
+		void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+		template< class T > T* allocate(size_t count); // Uninitialised. Destructors are never run, so only for trivially destructible types.
+		// Release everything allocated. If it took more than one block, they are replaced by a single one big enough for all of
+		// it, so a frame like the last one is served from one block without allocating.
+		void reset();
+		size_t getUsed() const;
+		size_t getCapacity() const;
+
+		FrameArena(size_t initialCapacity = 0);
+		FrameArena(const FrameArena&) = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+	};
+
+	/*
+	A std::vector borrowed from a pool of the calling thread until the Scratch is destroyed. Buffers keep their capacity when they
+	go back to the pool, so once a code path has run a few times borrowing and filling them no longer allocates. Scratches alive
+	at the same time get different buffers, and threads never share a pool, so this works in functions called from workers.
+	*/
+	template < class T > class Scratch {
+		std::vector < T >* buffer;
+
+		static std::vector < std::unique_ptr < std::vector < T > > >& pool();
+	public:
+		std::vector < T >& operator*();
+		std::vector < T >* operator->();
+
+		Scratch();
+		Scratch(const Scratch&) = delete;
+		Scratch& operator=(const Scratch&) = delete;
+		~Scratch();
+	};
+
+	/* sfte::FrameArena template implementation. Has to be in the header for the same reason in world.hpp */
+		template< class T > T* FrameArena::allocate(size_t count) {
+			static_assert(std::is_trivially_destructible< T >::value, "FrameArena never runs destructors");
+			return static_cast< T* >(allocate(count * sizeof(T), alignof(T)));
+		}
+
+	/* sfte::Scratch implementation. Has to be in the header for the same reason in world.hpp */
+		template< class T > std::vector< std::unique_ptr< std::vector< T > > >& Scratch< T >::pool() {
+			static thread_local std::vector< std::unique_ptr< std::vector< T > > > buffers;
+			return buffers;
+		}
+
+		template< class T > std::vector< T >& Scratch< T >::operator*() {
+			return *buffer;
+		}
+
+		template< class T > std::vector< T >* Scratch< T >::operator->() {
+			return buffer;
+		}
+
+		template< class T > Scratch< T >::Scratch() {
+			std::vector< std::unique_ptr< std::vector< T > > >& buffers = pool();
+			if(buffers.empty())
+				buffer = new std::vector< T >();
+			else {
+				buffer = buffers.back().release();
+				buffers.pop_back();
+			}
+		}
+
+		template< class T > Scratch< T >::~Scratch() {
+			buffer->clear();
+			pool().emplace_back(buffer);
+		}
+}
+
+#endif
\ No newline at end of file
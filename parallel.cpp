@@ -0,0 +1,63 @@
+#include "parallel.hpp"
+
+size_t sfte::workerCount() {
+	size_t count = std::thread::hardware_concurrency();
+	return (count == 0) ? 1 : count; // hardware_concurrency returns 0 when it can't tell
+}
+
+// sfte::WorkerPool implementation
+void sfte::WorkerPool::work() {
+	for(;;) {
+		size_t itemBegin = next.fetch_add(grain);
+		if(itemBegin >= end)
+			return;
+		try {
+			invoke(context, itemBegin, std::min(itemBegin + grain, end));
+		}
+		catch(...) {
+			std::lock_guard< std::mutex > lock(mutex);
+			if(!error)
+				error = std::current_exception();
+			next = end; // Hand out nothing else
+		}
+	}
+}
+
+void sfte::WorkerPool::workerLoop() {
+	unsigned long seen = 0;
+	std::unique_lock< std::mutex > lock(mutex);
+	for(;;) {
+		wake.wait(lock, [this, &seen]() { return quit || (generation != seen); });
+		if(quit)
+			return;
+		seen = generation;
+		lock.unlock();
+		work();
+		lock.lock();
+		if(--busy == 0)
+			finished.notify_one();
+	}
+}
+
+size_t sfte::WorkerPool::getThreadCount() {
+	return workers.size() + 1;
+}
+
+sfte::WorkerPool::WorkerPool(size_t threads) :
+	next(0)
+{
+	if(threads == 0)
+		threads = workerCount();
+	for(size_t t = 1; t < threads; ++t)
+		workers.push_back(std::thread(&WorkerPool::workerLoop, this));
+}
+
+sfte::WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard< std::mutex > lock(mutex);
+		quit = true;
+	}
+	wake.notify_all();
+	for(std::thread& worker : workers)
+		worker.join();
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#ifndef SFTE_PARALLEL_HPP
+#define SFTE_PARALLEL_HPP
+
+#include <thread>
+#include <exception>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "core.hpp"
+
+namespace sfte {
+	size_t workerCount(); // Number of threads to use for parallel work when none is specified. Always at least 1.
+
+	// Split [begin, end) into one contiguous band per thread and call function(bandBegin, bandEnd) for each band.
+	// The calling thread works on the first band. Exceptions thrown in any band are rethrown after every band finished.
+	template< class Function > void parallelFor(size_t begin, size_t end, Function function, size_t threads = 0);
+
+	class WorkerPool { // Threads kept alive between jobs, for work done every frame where starting threads each time would cost too much
+		std::vector< std::thread > workers;
+		std::mutex mutex;
+		std::condition_variable wake,		// Workers wait here for a job.
+								finished;	// run waits here for the workers to finish the job.
+		void (*invoke)(void*, size_t, size_t) = nullptr; // The current job. Type erased, so the pool doesn't have to be a template.
+		void* context = nullptr;
+		size_t end = 0,
+			   grain = 1;
+		std::atomic< size_t > next;			// First item which hasn't been handed out yet.
+		unsigned long generation = 0;		// Bumped for every job, so workers can tell a new job from a spurious wake up.
+		size_t busy = 0;					// Workers which haven't finished the current job yet.
+		std::exception_ptr error;			// First exception thrown by the current job.
+		bool quit = false;
+
+		void work(); // Take pieces of the current job until there are none left
+		void workerLoop();
+		template< class Function > static void invokeFunction(void* function, size_t itemBegin, size_t itemEnd);
+	public:
+		// Call function(itemBegin, itemEnd) on pieces of grain items of [begin, end). Pieces are taken in order by whichever thread is free, so
+		// items of uneven cost still balance out. The calling thread works too. Exceptions are rethrown once every piece is done.
+		// Only one thread may call run at a time.
+		template< class Function > void run(size_t begin, size_t end, Function function, size_t grain = 1);
+		size_t getThreadCount(); // Including the thread which calls run
+
+		WorkerPool(size_t threads = 0); // 0 = workerCount()
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+		~WorkerPool();
+	};
+
+	/* sfte::parallelFor implementation. Has to be in the header for the same reason in world.hpp */
+		template< class Function > void parallelFor(size_t begin, size_t end, Function function, size_t threads) {
+			if(end <= begin)
+				return;
+			if(threads == 0)
+				threads = workerCount();
+			if(threads > end - begin)
+				threads = end - begin;
+			if(threads == 1) { // Nothing to join or collect, so don't allocate for it
+				function(begin, end);
+				return;
+			}
+
+			std::vector< std::thread > workers;
+			std::vector< std::exception_ptr > errors(threads);
+			size_t bandSize = (end - begin) / threads,
+				   remainder = (end - begin) % threads;
+
+			// Launch bands 1 to threads - 1 on new threads. The first bands get one extra item each if the range doesn't divide evenly.
+			size_t bandBegin = begin + bandSize + (remainder > 0 ? 1 : 0);
+			for(size_t t = 1; t < threads; ++t) {
+				size_t bandEnd = bandBegin + bandSize + (t < remainder ? 1 : 0);
+				workers.push_back(std::thread([&function, &errors, t, bandBegin, bandEnd]() {
+					try {
+						function(bandBegin, bandEnd);
+					}
+					catch(...) {
+						errors[t] = std::current_exception();
+					}
+				}));
+				bandBegin = bandEnd;
+			}
+
+			try {
+				function(begin, begin + bandSize + (remainder > 0 ? 1 : 0));
+			}
+			catch(...) {
+				errors[0] = std::current_exception();
+			}
+
+			for(std::thread& worker : workers)
+				worker.join();
+			for(std::exception_ptr& error : errors) {
+				if(error)
+					std::rethrow_exception(error);
+			}
+		}
+
+	/* sfte::WorkerPool template implementation. Has to be in the header for the same reason in world.hpp */
+		template< class Function > void WorkerPool::invokeFunction(void* function, size_t itemBegin, size_t itemEnd) {
+			(*static_cast< Function* >(function))(itemBegin, itemEnd);
+		}
+
+		template< class Function > void WorkerPool::run(size_t begin, size_t end, Function function, size_t grain) {
+			if(end <= begin)
+				return;
+			if(workers.empty() || (end - begin <= grain)) { // Not worth waking anyone up
+				function(begin, end);
+				return;
+			}
+
+			{
+				std::lock_guard< std::mutex > lock(mutex);
+				invoke = &invokeFunction< Function >;
+				context = &function;
+				this->end = end;
+				this->grain = (grain == 0) ? 1 : grain;
+				next = begin;
+				busy = workers.size();
+				++generation;
+			}
+			wake.notify_all();
+			work();
+
+			std::unique_lock< std::mutex > lock(mutex);
+			finished.wait(lock, [this]() { return busy == 0; });
+			invoke = nullptr;
+			context = nullptr;
+			if(error) {
+				std::exception_ptr jobError = error;
+				error = nullptr;
+				std::rethrow_exception(jobError);
+			}
+		}
+}
+
+#endif
\ No newline at end of file
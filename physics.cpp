@@ -1,6 +1,71 @@
 #include "physics.hpp"
+#include "memory.hpp"
 
 sfte::PhysicsProperty::PhysicsProperty(bool isTangible, size_t collisionPropsID) :
 	tangible(isTangible),
 	collisionID(collisionPropsID)
-{ }
\ No newline at end of file
+{ }
+
+void sfte::mergeOccluderEdges(std::vector< OccluderEdge >& edges) {
+	// Edges on the same line are gone through together. Every edge flips the part of the line it covers, so parts covered an even
+	// number of times (inside the solid) disappear, and what is left is joined into as few edges as possible.
+	std::sort(edges.begin(), edges.end(), [](const OccluderEdge& l, const OccluderEdge& r) { return (l.x != r.x) ? (l.x < r.x) : (l.a < r.a); });
+
+	Scratch< std::pair< float, int > > endsBuffer;
+	std::vector< std::pair< float, int > >& ends = *endsBuffer;
+	size_t merged = 0;
+	for(size_t line = 0; line < edges.size();) {
+		size_t lineEnd = line;
+		ends.clear();
+		for(; (lineEnd < edges.size()) && (edges[lineEnd].x == edges[line].x) && (edges[lineEnd].a == edges[line].a); ++lineEnd) {
+			if(edges[lineEnd].s < edges[lineEnd].b) {
+				ends.push_back(std::make_pair(edges[lineEnd].s, 1));
+				ends.push_back(std::make_pair(edges[lineEnd].b, -1));
+			}
+		}
+		std::sort(ends.begin(), ends.end());
+
+		OccluderEdge edge = edges[line];
+		int covered = 0;
+		bool open = false;
+		for(size_t n = 0; n < ends.size();) {
+			float position = ends[n].first;
+			for(; (n < ends.size()) && (ends[n].first == position); ++n)
+				covered += ends[n].second;
+			if((covered % 2 != 0) && !open) {
+				edge.s = position;
+				open = true;
+			}
+			else if((covered % 2 == 0) && open) {
+				edge.b = position;
+				edges[merged++] = edge; // Never overtakes line, since a line gives at most as many edges as it had
+				open = false;
+			}
+		}
+		line = lineEnd;
+	}
+	edges.resize(merged);
+
+	// Where two solid tiles only touch at a corner, the merged edges would cross there. Edges are split where another one
+	// touches or crosses them, so that they only ever meet at their ends.
+	size_t yAligned = std::find_if(edges.begin(), edges.end(), [](const OccluderEdge& edge) { return edge.x; }) - edges.begin(); // y aligned edges come first
+	Scratch< OccluderEdge > splitBuffer;
+	std::vector< OccluderEdge >& split = *splitBuffer;
+	split.reserve(edges.size());
+	for(size_t n = 0; n < edges.size(); ++n) {
+		const OccluderEdge* crossing = edges.data() + (edges[n].x ? 0 : yAligned); // The other orientation, sorted by a
+		const OccluderEdge* crossingEnd = edges.data() + (edges[n].x ? yAligned : edges.size());
+		crossing = std::upper_bound(crossing, crossingEnd, edges[n].s, [](float position, const OccluderEdge& edge) { return position < edge.a; });
+		OccluderEdge edge = edges[n];
+		for(; (crossing != crossingEnd) && (crossing->a < edges[n].b); ++crossing) {
+			if((crossing->s <= edges[n].a) && (crossing->b >= edges[n].a)) {
+				edge.b = crossing->a;
+				split.push_back(edge);
+				edge.s = crossing->a;
+			}
+		}
+		edge.b = edges[n].b;
+		split.push_back(edge);
+	}
+	edges.swap(split); // The old buffer goes back to the scratch pool
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "core.hpp"
 #include "math.hpp"
+#include "world.hpp"
 #include "pointybox/pointybox.hpp"
 
 namespace sfte {
@@ -12,6 +13,16 @@ namespace sfte {
 		pb::EdgeVector edges;	// This holds edge data.
 	};
 
+	struct OccluderEdge { // Like pb::Edge, but in tiles instead of relative to a tile.
+		bool x;		// x aligned (| shape) if true, y aligned (- shape) if false.
+		float a,	// x of an x aligned edge, y of a y aligned one.
+			  s,	// Start and end along the edge, s <= b.
+			  b;
+	};
+
+	// Merge touching colinear edges into one, and drop edges which are there twice, like the shared side of two solid tiles.
+	void mergeOccluderEdges(std::vector< OccluderEdge >& edges);
+
 	struct PhysicsProperty {
 		bool tangible;		// Is the object tangible? If not, don't even bother with collision checking.
 		size_t collisionID;	// Where to look at in CollisionProperties when checking collisions.
@@ -19,6 +30,34 @@ namespace sfte {
 		PhysicsProperty(bool isTangible = false, size_t collisionPropsID = 0);
 	};
 
+	template< typename tileIDType > class EdgeMesh { // Occluder edges of the tangible tiles of a World, merged per chunk and rebuilt when the chunk's tiles change.
+		struct ChunkEdges {
+			std::vector< OccluderEdge > edges;	// Edges on the left and top sides of the chunk belong to it, the ones on its right and bottom sides to the next chunk.
+			unsigned long revision = 0;			// World revision the edges were built from.
+			bool valid = false;
+		};
+
+		World< tileIDType >* targetWorld;
+		CollisionProperties* collisionProperties;
+		std::vector< PhysicsProperty >* physicsProperties;
+		std::vector< ChunkEdges > chunks;		// x major, like World's chunks.
+		sf::Vector2u chunkCount;
+
+		unsigned long chunkRevision(sf::Vector2u chunkPosition); // Includes the tiles left of and above the chunk, which decide which of its edges are inside the solid
+		void buildChunk(sf::Vector2u chunkPosition);
+	public:
+		// Rebuild the chunks covering the area (in tiles, edges included) whose tiles changed. Edges on the right and bottom
+		// sides of the area belong to the tiles past it, so those should be included too. query only reads, so once the area
+		// is up to date it can be called from several threads at once.
+		void update(sf::Vector2u tlPosition, sf::Vector2u brPosition);
+		void query(float left, float top, float right, float bottom, std::vector< OccluderEdge >& out) const; // Append the edges touching the rectangle (in tiles), clipped to it. Chunks never updated are skipped.
+		const std::vector< OccluderEdge >& getChunkEdges(sf::Vector2u chunkPosition); // Rebuilt first if its tiles changed
+		size_t getEdgeCount() const; // Edges in the chunks built so far
+		void clear(); // Rebuild every chunk when it's next updated. Needed after changing the collision or physics properties tables.
+
+		EdgeMesh(World< tileIDType >* world, CollisionProperties* collisionProps, std::vector< PhysicsProperty >* physicsProps);
+	};
+
 	class PhysicsQuad {
 		
 
@@ -32,6 +71,111 @@ namespace sfte {
 	public:
 		
 	};
+
+	/*	sfte::EdgeMesh implementation. Has to be in the header for the same reason in world.hpp */
+		template< typename tileIDType > unsigned long EdgeMesh< tileIDType >::chunkRevision(sf::Vector2u chunkPosition) {
+			sf::Vector2u tl(chunkPosition.x * World< tileIDType >::chunkSize, chunkPosition.y * World< tileIDType >::chunkSize);
+			return targetWorld->getRevision(sf::Vector2u((tl.x > 0) ? tl.x - 1 : 0, (tl.y > 0) ? tl.y - 1 : 0), sf::Vector2u(tl.x + World< tileIDType >::chunkSize - 1, tl.y + World< tileIDType >::chunkSize - 1));
+		}
+
+		template< typename tileIDType > void EdgeMesh< tileIDType >::buildChunk(sf::Vector2u chunkPosition) {
+			ChunkEdges& chunk = chunks[(size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y];
+			sf::Vector3u mapSize(targetWorld->getTilemapSize());
+			size_t left = size_t(chunkPosition.x) * World< tileIDType >::chunkSize,
+				   top = size_t(chunkPosition.y) * World< tileIDType >::chunkSize,
+				   right = std::min(left + World< tileIDType >::chunkSize, size_t(mapSize.x)),	// Past the last column
+				   bottom = std::min(top + World< tileIDType >::chunkSize, size_t(mapSize.y));	// and the last row
+			chunk.revision = chunkRevision(chunkPosition);
+
+			// The column left of the chunk and the row above it are merged too, so that the sides shared with them cancel out
+			chunk.edges.clear();
+			for(size_t x = (left > 0) ? left - 1 : 0; x < right; ++x) {
+				for(size_t y = (top > 0) ? top - 1 : 0; y < bottom; ++y) {
+					tileIDType tileID = targetWorld->tile(sf::Vector3u(x, y, 0));
+					if(!physicsProperties->at(tileID).tangible)
+						continue;
+					size_t id = physicsProperties->at(tileID).collisionID;
+					unsigned char bitmask = targetWorld->getTileBitmask(sf::Vector3u(x, y, 0));
+					for(const pb::Edge& edge : collisionProperties->edges[id][bitmask])
+						chunk.edges.push_back(edge.x ? OccluderEdge{true, edge.a + x, edge.s + y, edge.b + y} : OccluderEdge{false, edge.a + y, edge.s + x, edge.b + x});
+				}
+			}
+			mergeOccluderEdges(chunk.edges);
+
+			// Keep what belongs to the chunk. Lines on its right and bottom sides belong to the next chunk, unless it is the last one.
+			size_t kept = 0;
+			for(OccluderEdge edge : chunk.edges) {
+				float lineBegin = edge.x ? left : top,
+					  lineEnd = edge.x ? right : bottom,
+					  mapEnd = edge.x ? mapSize.x : mapSize.y;
+				if((edge.a < lineBegin) || (edge.a > lineEnd) || ((edge.a == lineEnd) && (lineEnd != mapEnd)))
+					continue;
+				edge.s = std::max(edge.s, float(edge.x ? top : left));
+				edge.b = std::min(edge.b, float(edge.x ? bottom : right));
+				if(edge.s < edge.b)
+					chunk.edges[kept++] = edge;
+			}
+			chunk.edges.resize(kept);
+			chunk.valid = true;
+		}
+
+		template< typename tileIDType > void EdgeMesh< tileIDType >::update(sf::Vector2u tlPosition, sf::Vector2u brPosition) {
+			sf::Vector3u limits(targetWorld->getTilemapLimits());
+			size_t right = std::min(size_t(brPosition.x), size_t(limits.x)) / World< tileIDType >::chunkSize,
+				   bottom = std::min(size_t(brPosition.y), size_t(limits.y)) / World< tileIDType >::chunkSize;
+			for(size_t x = tlPosition.x / World< tileIDType >::chunkSize; x <= right; ++x) {
+				for(size_t y = tlPosition.y / World< tileIDType >::chunkSize; y <= bottom; ++y) {
+					const ChunkEdges& chunk = chunks[(x * chunkCount.y) + y];
+					if(!chunk.valid || (chunk.revision != chunkRevision(sf::Vector2u(x, y))))
+						buildChunk(sf::Vector2u(x, y));
+				}
+			}
+		}
+
+		template< typename tileIDType > void EdgeMesh< tileIDType >::query(float left, float top, float right, float bottom, std::vector< OccluderEdge >& out) const {
+			if((right < 0) || (bottom < 0) || (left > right) || (top > bottom))
+				return;
+			size_t chunkRight = std::min(size_t(right) / World< tileIDType >::chunkSize, size_t(chunkCount.x) - 1),
+				   chunkBottom = std::min(size_t(bottom) / World< tileIDType >::chunkSize, size_t(chunkCount.y) - 1);
+			for(size_t x = size_t(std::max(left, 0.0f)) / World< tileIDType >::chunkSize; x <= chunkRight; ++x) {
+				for(size_t y = size_t(std::max(top, 0.0f)) / World< tileIDType >::chunkSize; y <= chunkBottom; ++y) {
+					for(OccluderEdge edge : chunks[(x * chunkCount.y) + y].edges) {
+						if((edge.a < (edge.x ? left : top)) || (edge.a > (edge.x ? right : bottom)))
+							continue;
+						edge.s = std::max(edge.s, edge.x ? top : left);
+						edge.b = std::min(edge.b, edge.x ? bottom : right);
+						if(edge.s < edge.b)
+							out.push_back(edge);
+					}
+				}
+			}
+		}
+
+		template< typename tileIDType > const std::vector< OccluderEdge >& EdgeMesh< tileIDType >::getChunkEdges(sf::Vector2u chunkPosition) {
+			update(sf::Vector2u(chunkPosition.x * World< tileIDType >::chunkSize, chunkPosition.y * World< tileIDType >::chunkSize), sf::Vector2u(chunkPosition.x * World< tileIDType >::chunkSize, chunkPosition.y * World< tileIDType >::chunkSize));
+			return chunks[(size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y].edges;
+		}
+
+		template< typename tileIDType > size_t EdgeMesh< tileIDType >::getEdgeCount() const {
+			size_t count = 0;
+			for(const ChunkEdges& chunk : chunks)
+				count += chunk.edges.size();
+			return count;
+		}
+
+		template< typename tileIDType > void EdgeMesh< tileIDType >::clear() {
+			for(ChunkEdges& chunk : chunks)
+				chunk.valid = false;
+		}
+
+		template< typename tileIDType > EdgeMesh< tileIDType >::EdgeMesh(World< tileIDType >* world, CollisionProperties* collisionProps, std::vector< PhysicsProperty >* physicsProps) :
+			targetWorld(world),
+			collisionProperties(collisionProps),
+			physicsProperties(physicsProps),
+			chunkCount((world->getTilemapSize().x + World< tileIDType >::chunkSize - 1) / World< tileIDType >::chunkSize, (world->getTilemapSize().y + World< tileIDType >::chunkSize - 1) / World< tileIDType >::chunkSize)
+		{
+			chunks.resize(size_t(chunkCount.x) * chunkCount.y);
+		}
 }
 
 #endif
\ No newline at end of file
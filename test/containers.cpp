@@ -0,0 +1,171 @@
+/*
+Checks the queries of PointChunkMap and LooseChunkMap against a brute force search over every object while the objects move inside
+and between chunks, off the map, and are removed and added again. Removed IDs must stay invalid once a new object reuses their
+slot. The loose objects include ones larger than a chunk. Returns nonzero if any check fails.
+Build it with:
+	g++ -std=c++17 -O2 -I.. containers.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+*/
+#include "containers.hpp"
+#include <algorithm>
+#include <iostream>
+
+int failures = 0;
+
+void check(bool passed, const std::string& what) {
+	if(!passed) {
+		std::cout << "FAILED: " << what << std::endl;
+		++failures;
+	}
+}
+
+unsigned int seed = 1;
+
+float random(float low, float high) { // In steps of a quarter, so objects and queries often sit exactly on chunk edges
+	seed = (seed * 1103515245) + 12345;
+	return low + float((seed >> 8) % (unsigned int)((high - low) * 4 + 1)) / 4;
+}
+
+struct Object {
+	size_t id;
+	int value;
+	sf::Vector2f position,
+				 halfSize;
+};
+
+// The same tests as the maps do, for a box of halfSize around position. Points are boxes of half size 0.
+bool inRectangle(const Object& object, sf::Vector2f tlPoint, sf::Vector2f brPoint) {
+	if((tlPoint.x > brPoint.x) || (tlPoint.y > brPoint.y)) // An inverted rectangle is empty, even where a box covers both corners
+		return false;
+	return (object.position.x + object.halfSize.x >= tlPoint.x) && (object.position.x - object.halfSize.x <= brPoint.x) &&
+		   (object.position.y + object.halfSize.y >= tlPoint.y) && (object.position.y - object.halfSize.y <= brPoint.y);
+}
+
+bool inCircle(const Object& object, sf::Vector2f centre, float radius) {
+	float distX = centre.x - std::min(std::max(centre.x, object.position.x - object.halfSize.x), object.position.x + object.halfSize.x),
+		  distY = centre.y - std::min(std::max(centre.y, object.position.y - object.halfSize.y), object.position.y + object.halfSize.y);
+	return (distX * distX) + (distY * distY) <= radius * radius;
+}
+
+size_t add(sfte::PointChunkMap< int >& map, const Object& object) {
+	return map.add(object.value, object.position);
+}
+
+size_t add(sfte::LooseChunkMap< int >& map, const Object& object) {
+	return map.add(object.value, object.position, object.halfSize);
+}
+
+void resize(sfte::PointChunkMap< int >&, Object&, float) {}
+
+void resize(sfte::LooseChunkMap< int >& map, Object& object, float maxHalfSize) {
+	object.halfSize = sf::Vector2f(random(0, maxHalfSize), random(0, maxHalfSize));
+	map.resize(object.id, object.halfSize);
+}
+
+template< class mapType > void testMap(const std::string& name, float maxHalfSize) {
+	// 16x16 chunks of 16 units
+	mapType map(sf::Vector2f(256, 256), sf::Vector2f(16, 16));
+	std::vector< Object > objects;
+	std::vector< size_t > stale;	// IDs of removed objects
+	int nextValue = 0;
+	auto spawn = [&]() {
+		Object object = { 0, nextValue++, sf::Vector2f(random(-32, 288), random(-32, 288)), sf::Vector2f(random(0, maxHalfSize), random(0, maxHalfSize)) };
+		if(maxHalfSize == 0)
+			object.halfSize = sf::Vector2f(0, 0);
+		object.id = add(map, object);
+		objects.push_back(object);
+	};
+	for(int n = 0; n < 500; ++n)
+		spawn();
+
+	std::vector< size_t > found, expected;
+	for(int frame = 0; frame < 100; ++frame) {
+		for(Object& object : objects) {
+			seed = (seed * 1103515245) + 12345;
+			if((seed >> 8) % 16 == 0) // Anywhere, including off the map
+				object.position = sf::Vector2f(random(-32, 288), random(-32, 288));
+			else // A small step, which mostly stays in the chunk
+				object.position += sf::Vector2f(random(-2, 2), random(-2, 2));
+			map.move(object.id, object.position);
+			if((seed >> 8) % 16 == 1)
+				resize(map, object, maxHalfSize);
+		}
+
+		// Remove a few and add as many, which reuses the freed slots
+		for(int n = 0; n < 5; ++n) {
+			size_t index = size_t(random(0, objects.size() - 1));
+			map.remove(objects[index].id);
+			stale.push_back(objects[index].id);
+			objects[index] = objects.back();
+			objects.pop_back();
+		}
+		for(int n = 0; n < 5; ++n)
+			spawn();
+
+		size_t reused = 0;
+		for(size_t id : stale) {
+			check(!map.contains(id), name + ": removed ID " + std::to_string(id) + " is still contained");
+			bool threw = false;
+			try {
+				map.move(id, sf::Vector2f(0, 0));
+			}
+			catch(const std::exception&) {
+				threw = true;
+			}
+			check(threw, name + ": moving removed ID " + std::to_string(id) + " didn't throw");
+			threw = false;
+			try {
+				map[id];
+			}
+			catch(const std::exception&) {
+				threw = true;
+			}
+			check(threw, name + ": accessing removed ID " + std::to_string(id) + " didn't throw");
+			for(const Object& object : objects)
+				reused += mapType::slotOf(object.id) == mapType::slotOf(id);
+		}
+		check(reused > 0, name + ": no removed slot was reused in frame " + std::to_string(frame));
+
+		for(const Object& object : objects) {
+			check(map.contains(object.id) && (map[object.id] == object.value), name + ": object " + std::to_string(object.id) + " lost its value");
+			check(map.getPosition(object.id) == object.position, name + ": object " + std::to_string(object.id) + " is in the wrong place");
+		}
+		check(map.size() == objects.size(), name + ": size " + std::to_string(map.size()) + " instead of " + std::to_string(objects.size()));
+
+		for(int query = 0; query < 20; ++query) {
+			sf::Vector2f tlPoint(random(-48, 288), random(-48, 288)),
+						 brPoint(tlPoint.x + random(-4, 64), tlPoint.y + random(-4, 64)); // Sometimes inverted, which finds nothing
+			found.clear();
+			expected.clear();
+			map.query(tlPoint, brPoint, found);
+			for(const Object& object : objects) {
+				if(inRectangle(object, tlPoint, brPoint))
+					expected.push_back(object.id);
+			}
+			std::sort(found.begin(), found.end());
+			std::sort(expected.begin(), expected.end());
+			check(found == expected, name + ": rectangle " + std::to_string(tlPoint.x) + ", " + std::to_string(tlPoint.y) + " to " + std::to_string(brPoint.x) + ", " + std::to_string(brPoint.y) +
+									 " found " + std::to_string(found.size()) + " objects instead of " + std::to_string(expected.size()));
+
+			sf::Vector2f centre(random(-48, 288), random(-48, 288));
+			float radius = random(0, 48);
+			found.clear();
+			expected.clear();
+			map.queryRadius(centre, radius, found);
+			for(const Object& object : objects) {
+				if(inCircle(object, centre, radius))
+					expected.push_back(object.id);
+			}
+			std::sort(found.begin(), found.end());
+			std::sort(expected.begin(), expected.end());
+			check(found == expected, name + ": circle at " + std::to_string(centre.x) + ", " + std::to_string(centre.y) + " of radius " + std::to_string(radius) +
+									 " found " + std::to_string(found.size()) + " objects instead of " + std::to_string(expected.size()));
+		}
+	}
+}
+
+int main() {
+	testMap< sfte::PointChunkMap< int > >("PointChunkMap", 0);
+	testMap< sfte::LooseChunkMap< int > >("LooseChunkMap", 40); // Up to 5 chunks wide
+	std::cout << (failures ? "FAILED" : "passed") << std::endl;
+	return failures ? 1 : 0;
+}
\ No newline at end of file
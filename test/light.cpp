@@ -0,0 +1,228 @@
+/*
+Checks the sweep light engine against the ray caster and against exact visibility on a small random map, including lights on the
+corners of the world and of radius 0, where the sweep has no direction to some of its events. Returns nonzero if any check fails.
+Build it with:
+	g++ -std=c++17 -O2 -I.. light.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+*/
+#include "light.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+struct Scene {
+	std::vector< sfte::TileProperty > tileProperties;
+	sfte::CollisionProperties collisionProperties;
+	std::vector< sfte::PhysicsProperty > physicsProperties;
+	sfte::World< std::uint8_t > world;
+
+	bool visible(sf::Vector2f from, sf::Vector2f to) { // No solid tile's inside is crossed by the segment. In tiles.
+		for(int x = std::floor(std::min(from.x, to.x)); x <= std::floor(std::max(from.x, to.x)); ++x) {
+			for(int y = std::floor(std::min(from.y, to.y)); y <= std::floor(std::max(from.y, to.y)); ++y) {
+				if((x < 0) || (y < 0) || (unsigned(x) >= world.getTilemapSize().x) || (unsigned(y) >= world.getTilemapSize().y) || !world.tile(sf::Vector3u(x, y, 0)))
+					continue;
+				float enter = 0,
+					  leave = 1;
+				float start[] = { from.x, from.y }, delta[] = { to.x - from.x, to.y - from.y }, low[] = { float(x), float(y) };
+				for(int axis = 0; axis < 2; ++axis) {
+					if(delta[axis] == 0) {
+						if((start[axis] <= low[axis]) || (start[axis] >= low[axis] + 1))
+							enter = 2;
+						continue;
+					}
+					float t1 = (low[axis] - start[axis]) / delta[axis],
+						  t2 = (low[axis] + 1 - start[axis]) / delta[axis];
+					enter = std::max(enter, std::min(t1, t2));
+					leave = std::min(leave, std::max(t1, t2));
+				}
+				if(enter < leave)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	Scene(unsigned int size, unsigned int solidOneIn = 7) :
+		tileProperties{ sfte::TileProperty(sf::Vector2f(0, 0), sf::Vector2f(16, 16), false), sfte::TileProperty(sf::Vector2f(16, 0), sf::Vector2f(16, 16), true, sfte::visibilityOpaque, 1) },
+		physicsProperties{ sfte::PhysicsProperty(false, 0), sfte::PhysicsProperty(true, 0) },
+		world(&tileProperties, sf::Vector3u(size, size, 1), sf::Vector2u(16, 16), nullptr, std::vector< sf::Color >(1, sf::Color::White), 0, nullptr)
+	{
+		// Full tiles, with the same edges whatever their neighbours are
+		collisionProperties.edges.resize(1);
+		collisionProperties.points.resize(1);
+		for(int mask = 0; mask < 16; ++mask) {
+			collisionProperties.edges[0].push_back({ { true, 0, 0, 1 }, { true, 1, 0, 1 }, { false, 0, 0, 1 }, { false, 1, 0, 1 } });
+			collisionProperties.points[0].push_back({ sf::Vector2f(0, 0), sf::Vector2f(1, 0), sf::Vector2f(1, 1), sf::Vector2f(0, 1) });
+		}
+		unsigned int seed = 3;
+		world.beginEdit();
+		for(unsigned int x = 0; x < size; ++x) {
+			for(unsigned int y = 0; y < size; ++y) {
+				seed = (seed * 1103515245) + 12345;
+				if((seed >> 16) % solidOneIn == 0)
+					world.tile(sf::Vector3u(x, y, 0), 1);
+			}
+		}
+		world.commitEdit();
+	}
+};
+
+int failures = 0;
+
+void check(bool passed, const std::string& what) {
+	if(!passed) {
+		std::cout << "FAILED: " << what << std::endl;
+		++failures;
+	}
+}
+
+bool hasPoint(const std::vector< sf::Vector2f >& polygon, sf::Vector2f point) {
+	return std::find(polygon.begin(), polygon.end(), point) != polygon.end();
+}
+
+void testSweepCorners() {
+	// Without edges the polygon is the box. From a corner of it, the other three corners have to be in it.
+	sf::Vector2f corners[] = { sf::Vector2f(0, 0), sf::Vector2f(5, 0), sf::Vector2f(5, 5), sf::Vector2f(0, 5) };
+	std::vector< sfte::OccluderEdge > edges;
+	std::vector< sf::Vector2f > polygon;
+	for(sf::Vector2f origin : corners) {
+		sfte::sweepLightPolygon(origin, edges, 0, 0, 5, 5, 0, polygon);
+		for(sf::Vector2f corner : corners) {
+			if(corner != origin)
+				check(hasPoint(polygon, corner), "sweep from a corner of the box reaches the others, origin = " + std::to_string(origin.x) + ", " + std::to_string(origin.y));
+		}
+	}
+
+	// A box of no area lights nothing
+	sfte::sweepLightPolygon(sf::Vector2f(0, 0), edges, 0, 0, 0, 0, 0, polygon);
+	check(polygon.empty(), "sweep with an empty box");
+	sfte::sweepLightPolygon(sf::Vector2f(2, 3), edges, 2, 3, 2, 3, 0, polygon);
+	check(polygon.empty(), "sweep with a box of radius 0");
+}
+
+void testEnginesMatch() {
+	// Same lights with both engines, drawn on the CPU. Only pixels along the polygons' edges may differ.
+	unsigned int size = 32;
+	Scene scene(size);
+	sfte::SoftwareLightBackend* raycastBackend = new sfte::SoftwareLightBackend(1);
+	sfte::SoftwareLightBackend* sweepBackend = new sfte::SoftwareLightBackend(1);
+	sfte::LightMap< std::uint8_t > raycast(&scene.world, &scene.collisionProperties, &scene.physicsProperties, raycastBackend),
+								   sweep(&scene.world, &scene.collisionProperties, &scene.physicsProperties, sweepBackend);
+	raycast.setEngine(sfte::lightEngineRaycast);
+	sweep.setEngine(sfte::lightEngineSweep);
+	raycast.setAmbientColor(sf::Color::Black);
+	sweep.setAmbientColor(sf::Color::Black);
+
+	float world = size * 16.0f;
+	float edge = world - 0.5f; // Lights further than this are outside of the world
+	std::vector< sfte::PointLight > lights = { sfte::PointLight(sf::Vector2f(0, 0), 100), sfte::PointLight(sf::Vector2f(edge, 0), 100),
+											   sfte::PointLight(sf::Vector2f(edge, edge), 100), sfte::PointLight(sf::Vector2f(0, edge), 600),
+											   sfte::PointLight(sf::Vector2f(0, 0), 0), sfte::PointLight(sf::Vector2f(200, 200), 0),
+											   sfte::PointLight(sf::Vector2f(64, 40), 150), sfte::PointLight(sf::Vector2f(0, 200), 120) };
+	unsigned int seed = 9;
+	while(lights.size() < 40) {
+		seed = (seed * 1103515245) + 12345;
+		sf::Vector2f position(float((seed >> 8) % 5120) / 10, float((seed >> 4) % 5120) / 10);
+		if(lights.size() % 4 == 0)
+			position = sf::Vector2f(std::floor(position.x / 16) * 16, position.y); // On a tile line
+		if(!scene.physicsProperties[scene.world.tile(sf::Vector3u(position.x / 16, position.y / 16, 0))].tangible)
+			lights.push_back(sfte::PointLight(position, 20 + ((seed >> 12) % 300)));
+	}
+
+	for(const sfte::PointLight& light : lights) {
+		raycast.beginFrame(sf::Vector2f(0, 0), sf::Vector2f(world, world));
+		raycast.submit(light, 0);
+		raycast.resolve(nullptr);
+		sweep.beginFrame(sf::Vector2f(0, 0), sf::Vector2f(world, world));
+		sweep.submit(light, 0);
+		sweep.resolve(nullptr);
+
+		// Pixels inside the world and well inside the radius, where the light is still bright, against whether they see the light.
+		// Pixels a shadow's edge passes through are skipped, as either answer is right there. The ray caster's DDA misses some
+		// corners, so the sweep may differ from it only where it is wrong.
+		size_t inside = 0,
+			   lit = 0,
+			   sweepWrong = 0,
+			   differing = 0;
+		const std::uint8_t* raycastPixels = raycastBackend->getPixels();
+		const std::uint8_t* sweepPixels = sweepBackend->getPixels();
+		for(unsigned int y = 0; y < world; ++y) {
+			for(unsigned int x = 0; x < world; ++x) {
+				size_t i = ((size_t(y) * size_t(world)) + x) * 4;
+				bool raycastLit = raycastPixels[i] > 4;
+				bool sweepLit = sweepPixels[i] > 4;
+				lit += raycastLit || sweepLit;
+				sf::Vector2f offset = sf::Vector2f(x + 0.5f, y + 0.5f) - light.position;
+				if((x + 1 >= world) || (y + 1 >= world) || (std::sqrt((offset.x * offset.x) + (offset.y * offset.y)) > light.radius * 0.9f))
+					continue;
+				int seen = 0;
+				for(int corner = 0; corner < 4; ++corner)
+					seen += scene.visible(light.position * (1 / 16.0f), sf::Vector2f(x + 0.25f + (corner % 2) * 0.5f, y + 0.25f + (corner / 2) * 0.5f) * (1 / 16.0f));
+				if((seen != 0) && (seen != 4))
+					continue;
+				bool visible = seen == 4;
+				++inside;
+				sweepWrong += sweepLit != visible;
+				differing += (raycastLit != sweepLit) && (raycastLit == visible);
+			}
+		}
+		std::string name = "light at " + std::to_string(light.position.x) + ", " + std::to_string(light.position.y) + " of radius " + std::to_string(light.radius);
+		if(light.radius == 0)
+			check(lit == 0, name + " lights nothing");
+		check(sweepWrong <= (inside / 200) + 16, name + ": sweep wrong for " + std::to_string(sweepWrong) + " of " + std::to_string(inside) + " pixels");
+		check(differing <= (inside / 200) + 16, name + ": sweep differs from a right ray caster for " + std::to_string(differing) + " of " + std::to_string(inside) + " pixels");
+	}
+}
+
+void testRayCap() {
+	// Area lights with many samples on a dense map, where the penumbra samples would cast far more rays than the cap
+	unsigned int size = 48;
+	Scene scene(size, 3);
+	sfte::LightMap< std::uint8_t > lightMap(&scene.world, &scene.collisionProperties, &scene.physicsProperties, new sfte::SoftwareLightBackend(1));
+	std::vector< size_t > lights;
+	unsigned int seed = 4;
+	while(lights.size() < 30) {
+		seed = (seed * 1103515245) + 12345;
+		sf::Vector2f position(float((seed >> 8) % (size * 160)) / 10, float((seed >> 4) % (size * 160)) / 10);
+		if(!scene.physicsProperties[scene.world.tile(sf::Vector3u(position.x / 16, position.y / 16, 0))].tangible)
+			lights.push_back(lightMap.addLight(sfte::PointLight(position, 60 + ((seed >> 12) % 200), sf::Color::White, 6, 32)));
+	}
+	sf::Vector2f topLeft(0, 0), bottomRight(size - 1, size - 1);
+
+	// Rays of the centre polygon alone, which is cast whatever the cap, and of every sample
+	std::vector< size_t > centre, all;
+	for(size_t light : lights)
+		lightMap.setLightQuality(light, 1);
+	lightMap.render(topLeft, bottomRight);
+	for(size_t light : lights)
+		centre.push_back(lightMap.getLightRays(light));
+	for(size_t light : lights)
+		lightMap.setLightQuality(light, 32);
+	lightMap.setRayCap(size_t(-1));
+	lightMap.render(topLeft, bottomRight);
+	size_t over = 0;
+	for(size_t n = 0; n < lights.size(); ++n)
+		all.push_back(lightMap.getLightRays(lights[n]));
+
+	size_t caps[] = { 0, 100, 1000, 4000 };
+	for(size_t cap : caps) {
+		lightMap.setRayCap(cap);
+		lightMap.render(topLeft, bottomRight);
+		for(size_t n = 0; n < lights.size(); ++n) {
+			size_t rays = lightMap.getLightRays(lights[n]);
+			over += all[n] > cap;
+			check(rays <= std::max(cap, centre[n]), "light " + std::to_string(n) + " with a cap of " + std::to_string(cap) + " cast " + std::to_string(rays) + " rays");
+			check(rays >= centre[n], "light " + std::to_string(n) + " with a cap of " + std::to_string(cap) + " didn't cast its centre polygon");
+		}
+	}
+	check(over > 0, "some light goes over the caps without them");
+}
+
+int main() {
+	testSweepCorners();
+	testEnginesMatch();
+	testRayCap();
+	std::cout << (failures ? "FAILED" : "passed") << std::endl;
+	return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+/*
+Checks nearestEdgeHit against a plain loop over the edges, on random edge sets and rays, including crossings behind the ray's start
+and rays parallel to an axis. Which of the AVX, SSE and scalar versions is built depends on the compiler flags, so build and run it
+once for each, e.g.:
+	g++ -std=c++17 -O2 -mavx -I.. math.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+	g++ -std=c++17 -O2 -I.. math.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+	g++ -std=c++17 -O2 -U__SSE2__ -I.. math.cpp ../*.cpp -lsfml-graphics -lsfml-window -lsfml-system -pthread
+Returns nonzero if any check fails.
+*/
+#include "math.hpp"
+#include <cmath>
+#include <iostream>
+#include <string>
+
+struct Edge {
+	bool x;
+	float a, s, b;
+};
+
+// The scalar version of nearestEdgeHit written out for every edge, without the arrays or their padding
+bool referenceHit(sf::Vector2f point, sf::Vector2f direction, float from, const std::vector< Edge >& edges, float& hit) {
+	float invX = 1.0f / direction.x,
+		  invY = 1.0f / direction.y,
+		  bestSq = INFINITY;
+	for(const Edge& edge : edges) {
+		float t = edge.x ? ((edge.a - point.x) * invX) : ((edge.a - point.y) * invY),
+			  cross = edge.x ? (point.y + (t * direction.y)) : (point.x + (t * direction.x)),
+			  u = t - from;
+		if((cross >= edge.s) && (cross <= edge.b) && (u >= 0) && ((u * u) < bestSq)) {
+			hit = t;
+			bestSq = u * u;
+		}
+	}
+	return bestSq != INFINITY;
+}
+
+unsigned int seed = 1;
+
+float random(float range) { // 0 to range, in steps of range / 64 so that rays often pass exactly through edge ends
+	seed = (seed * 1103515245) + 12345;
+	return float((seed >> 16) % 65) * range / 64;
+}
+
+int main() {
+#if defined(__AVX__)
+	std::cout << "AVX" << std::endl;
+#elif defined(__SSE2__) || defined(_M_X64)
+	std::cout << "SSE" << std::endl;
+#else
+	std::cout << "scalar" << std::endl;
+#endif
+	int failures = 0;
+	std::vector< Edge > edges;
+	sfte::EdgeArrays arrays;
+	for(int set = 0; set < 2000; ++set) {
+		// Up to 40 edges, so every count of padding lanes is covered
+		edges.clear();
+		arrays.clear();
+		size_t count = random(40);
+		for(size_t n = 0; n < count; ++n) {
+			Edge edge = { random(1) >= 0.5f, random(16), random(16), 0 };
+			edge.b = edge.s + random(4);
+			edges.push_back(edge);
+			arrays.add(edge.x, edge.a, edge.s, edge.b);
+		}
+
+		for(int ray = 0; ray < 50; ++ray) {
+			sf::Vector2f point(random(16), random(16)),
+						 direction(random(2) - 1, random(2) - 1);
+			if(ray % 10 == 0)
+				direction.x = 0;
+			else if(ray % 10 == 1)
+				direction.y = 0;
+			float from = (ray % 3 == 0) ? 0 : random(2); // Crossings with t < from are behind the start and don't count
+			float expected = 0,
+				  hit = 0;
+			bool expectHit = referenceHit(point, direction, from, edges, expected),
+				 gotHit = sfte::nearestEdgeHit(point, direction, from, arrays, hit);
+			if((expectHit != gotHit) || (gotHit && (hit != expected))) {
+				if(++failures <= 10) {
+					std::cout << "FAILED: set " << set << ", ray from " << point.x << ", " << point.y << " along " << direction.x << ", " << direction.y << " past " << from
+							  << ": expected " << (expectHit ? std::to_string(expected) : std::string("no hit")) << ", got " << (gotHit ? std::to_string(hit) : std::string("no hit")) << std::endl;
+				}
+			}
+		}
+	}
+	std::cout << (failures ? "FAILED" : "passed") << std::endl;
+	return failures ? 1 : 0;
+}
\ No newline at end of file
@@ -1,4 +1,46 @@
 #include "text.hpp"
+#include <stdexcept>
+
+namespace {
+    // Write the quad of character c with its top left corner at corner, with the quad of its shadow before it when shadowing.
+    // Returns the vertex after them.
+    sf::Vertex* writeGlyph(sf::Vertex* vertex, unsigned char c, sf::Vector2f corner, sf::Vector2f fontSize, sf::Vector2u charBounds, sf::Color color, bool shadowing, sf::Vector2f shadowOffset, float shadowFactor) {
+        float left = corner.x,
+              top = corner.y,
+              right = left + fontSize.x,
+              bottom = top + fontSize.y,
+              texLeft = float(c * charBounds.x),
+              texRight = texLeft + charBounds.x;
+        if(shadowing) {
+            sf::Color shadowColor(0, 0, 0, color.a * shadowFactor);
+            *vertex++ = sf::Vertex(sf::Vector2f(left + shadowOffset.x, top + shadowOffset.y), shadowColor, sf::Vector2f(texLeft, 0));
+            *vertex++ = sf::Vertex(sf::Vector2f(right + shadowOffset.x, top + shadowOffset.y), shadowColor, sf::Vector2f(texRight, 0));
+            *vertex++ = sf::Vertex(sf::Vector2f(right + shadowOffset.x, bottom + shadowOffset.y), shadowColor, sf::Vector2f(texRight, charBounds.y));
+            *vertex++ = sf::Vertex(sf::Vector2f(left + shadowOffset.x, bottom + shadowOffset.y), shadowColor, sf::Vector2f(texLeft, charBounds.y));
+        }
+        *vertex++ = sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(texLeft, 0));
+        *vertex++ = sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(texRight, 0));
+        *vertex++ = sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(texRight, charBounds.y));
+        *vertex++ = sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(texLeft, charBounds.y));
+        return vertex;
+    }
+
+    // Move the cursor past character c. glyph counts the characters which are drawn.
+    void advance(char c, size_t maxColumns, size_t& row, size_t& column, size_t& glyph) {
+        if(c == '\n') {
+            ++row;
+            column = 0;
+            return;
+        }
+        ++glyph;
+        if((maxColumns != 0) && (column >= maxColumns - 1)) {
+            column = 0;
+            ++row;
+        }
+        else
+            ++column;
+    }
+}
 
 sfte::Text::Text(sf::Texture* fontTexture, sf::Vector2u characterBounds) :
     texture(fontTexture),
@@ -6,53 +48,182 @@ sfte::Text::Text(sf::Texture* fontTexture, sf::Vector2u characterBounds) :
     vertexArray(sf::PrimitiveType::Quads)
 {}
 
-void sfte::Text::print(sf::RenderTarget* renderTarget, std::string toPrint, sf::Vector2f position, sf::Vector2f fontSize, size_t maxColumns, sf::Color color, bool shadowing, sf::Vector2f shadowOffset, float shadowFactor) {
+void sfte::Text::print(sf::RenderTarget* renderTarget, std::string_view toPrint, sf::Vector2f position, sf::Vector2f fontSize, size_t maxColumns, sf::Color color, bool shadowing, sf::Vector2f shadowOffset, float shadowFactor) {
     if(!toPrint.empty()) {
         vertexArray.resize(toPrint.size() * (shadowing ? 8 : 4));
-        size_t n = 0;
-        for(size_t c = 0, row = 0, col = 0; c < toPrint.size(); ++c) {
-            switch(toPrint[c]) {
-            case '\n':
-                ++row;
-                col = 0;
-                break;
-            default:
-                if(shadowing) {
-                    vertexArray[n  ].position  = sf::Vector2f(position.x + (col * fontSize.x) + shadowOffset.x, position.y + (row * fontSize.y) + shadowOffset.y);
-                    vertexArray[n  ].texCoords = sf::Vector2f(toPrint[c] * charBounds.x, 0);
-                    vertexArray[n++].color     = sf::Color(0, 0, 0, color.a * shadowFactor);
-                    vertexArray[n  ].position  = sf::Vector2f(position.x + (col * fontSize.x) + fontSize.x + shadowOffset.x, position.y + (row * fontSize.y) + shadowOffset.y);
-                    vertexArray[n  ].texCoords = sf::Vector2f(toPrint[c] * charBounds.x + charBounds.x, 0);
-                    vertexArray[n++].color     = sf::Color(0, 0, 0, color.a * shadowFactor);
-                    vertexArray[n  ].position  = sf::Vector2f(position.x + (col * fontSize.x) + fontSize.x + shadowOffset.x, position.y + (row * fontSize.y) + fontSize.y + shadowOffset.y);
-                    vertexArray[n  ].texCoords = sf::Vector2f(toPrint[c] * charBounds.x + charBounds.x, charBounds.y);
-                    vertexArray[n++].color     = sf::Color(0, 0, 0, color.a * shadowFactor);
-                    vertexArray[n  ].position  = sf::Vector2f(position.x + (col * fontSize.x) + shadowOffset.x, position.y + (row * fontSize.y) + fontSize.y + shadowOffset.y);
-                    vertexArray[n  ].texCoords = sf::Vector2f(toPrint[c] * charBounds.x, charBounds.y);
-                    vertexArray[n++].color     = sf::Color(0, 0, 0, color.a * shadowFactor);
-                }
-                vertexArray[n  ].position  = sf::Vector2f(position.x + (col * fontSize.x), position.y + (row * fontSize.y));
-                vertexArray[n  ].texCoords = sf::Vector2f(toPrint[c] * charBounds.x, 0);
-                vertexArray[n++].color     = color;
-                vertexArray[n  ].position  = sf::Vector2f(position.x + (col * fontSize.x) + fontSize.x, position.y + (row * fontSize.y));
-                vertexArray[n  ].texCoords = sf::Vector2f(toPrint[c] * charBounds.x + charBounds.x, 0);
-                vertexArray[n++].color     = color;
-                vertexArray[n  ].position  = sf::Vector2f(position.x + (col * fontSize.x) + fontSize.x, position.y + (row * fontSize.y) + fontSize.y);
-                vertexArray[n  ].texCoords = sf::Vector2f(toPrint[c] * charBounds.x + charBounds.x, charBounds.y);
-                vertexArray[n++].color     = color;
-                vertexArray[n  ].position  = sf::Vector2f(position.x + (col * fontSize.x), position.y + (row * fontSize.y) + fontSize.y);
-                vertexArray[n  ].texCoords = sf::Vector2f(toPrint[c] * charBounds.x, charBounds.y);
-                vertexArray[n++].color     = color;
-                if((maxColumns != 0) && (col >= maxColumns - 1)) {
-                    col = 0;
-                    ++row;
-                }
-                else
-                    ++col;
-                break;
-            }
+        sf::Vertex* vertex = &vertexArray[0];
+        for(size_t c = 0, row = 0, column = 0, glyph = 0; c < toPrint.size(); ++c) {
+            if(toPrint[c] != '\n')
+                vertex = writeGlyph(vertex, toPrint[c], sf::Vector2f(position.x + (column * fontSize.x), position.y + (row * fontSize.y)), fontSize, charBounds, color, shadowing, shadowOffset, shadowFactor);
+            advance(toPrint[c], maxColumns, row, column, glyph);
         }
-        vertexArray.resize(n);
+        vertexArray.resize(vertex - &vertexArray[0]);
         renderTarget->draw(vertexArray, texture);
     }
-}
\ No newline at end of file
+}
+
+// sfte::TextBlock implementation
+void sfte::TextBlock::layout(size_t from, size_t row, size_t column, size_t glyph) {
+    size_t perGlyph = shadowing ? 8 : 4,
+           glyphs = glyph + (text.size() - from) - std::count(text.begin() + from, text.end(), '\n');
+    vertexArray.resize(glyphs * perGlyph); // Keeps its memory when it shrinks
+    if(glyphs == glyph)
+        return;
+    sf::Vertex* vertex = &vertexArray[glyph * perGlyph];
+    for(size_t c = from; c < text.size(); ++c) {
+        if(text[c] != '\n')
+            vertex = writeGlyph(vertex, text[c], sf::Vector2f(column * fontSize.x, row * fontSize.y), fontSize, charBounds, color, shadowing, shadowOffset, shadowFactor);
+        advance(text[c], maxColumns, row, column, glyph);
+    }
+}
+
+void sfte::TextBlock::setString(std::string_view string) {
+    // Characters replaced by other characters are drawn at the same place, so only their own quads change
+    size_t perGlyph = shadowing ? 8 : 4,
+           common = std::min(text.size(), string.size()),
+           row = 0,
+           column = 0,
+           glyph = 0,
+           c = 0;
+    for(; c < common; ++c) {
+        if(text[c] != string[c]) {
+            if((text[c] == '\n') || (string[c] == '\n'))
+                break; // Moves everything after it
+            text[c] = string[c];
+            writeGlyph(&vertexArray[glyph * perGlyph], text[c], sf::Vector2f(column * fontSize.x, row * fontSize.y), fontSize, charBounds, color, shadowing, shadowOffset, shadowFactor);
+        }
+        advance(text[c], maxColumns, row, column, glyph);
+    }
+    if((c == text.size()) && (c == string.size()))
+        return;
+    text.assign(string.data(), string.size());
+    layout(c, row, column, glyph);
+}
+
+const std::string& sfte::TextBlock::getString() const {
+    return text;
+}
+
+void sfte::TextBlock::setPosition(sf::Vector2f textPosition) {
+    position = textPosition;
+}
+
+sf::Vector2f sfte::TextBlock::getPosition() const {
+    return position;
+}
+
+void sfte::TextBlock::setColor(sf::Color textColor) {
+    color = textColor;
+    sf::Color shadowColor(0, 0, 0, color.a * shadowFactor);
+    for(size_t n = 0; n < vertexArray.getVertexCount(); ++n)
+        vertexArray[n].color = (shadowing && ((n % 8) < 4)) ? shadowColor : color;
+}
+
+void sfte::TextBlock::setStyle(sf::Vector2f textFontSize, size_t textMaxColumns, bool textShadowing, sf::Vector2f textShadowOffset, float textShadowFactor) {
+    fontSize = textFontSize;
+    maxColumns = textMaxColumns;
+    shadowing = textShadowing;
+    shadowOffset = textShadowOffset;
+    shadowFactor = textShadowFactor;
+    layout(0, 0, 0, 0);
+}
+
+void sfte::TextBlock::draw(sf::RenderTarget* renderTarget) const {
+    if(vertexArray.getVertexCount() > 0) {
+        sf::RenderStates states(texture);
+        states.transform.translate(position);
+        renderTarget->draw(vertexArray, states);
+    }
+}
+
+sfte::TextBlock::TextBlock(sf::Texture* fontTexture, sf::Vector2u characterBounds, sf::Vector2f textFontSize, size_t textMaxColumns, sf::Color textColor, bool textShadowing, sf::Vector2f textShadowOffset, float textShadowFactor) :
+    texture(fontTexture),
+    charBounds(characterBounds),
+    vertexArray(sf::PrimitiveType::Quads),
+    fontSize(textFontSize),
+    maxColumns(textMaxColumns),
+    color(textColor),
+    shadowing(textShadowing),
+    shadowOffset(textShadowOffset),
+    shadowFactor(textShadowFactor)
+{}
+
+// sfte::TextBatch implementation
+void sfte::TextBatch::append(const sf::Vertex* quad, sf::Vector2f offset) {
+    // Quads are axis aligned with their corners in the order TL, TR, BR, BL, so cutting one is clamping its sides and moving
+    // its texture coordinates by as much
+    float left = quad[0].position.x + offset.x,
+          top = quad[0].position.y + offset.y,
+          right = quad[2].position.x + offset.x,
+          bottom = quad[2].position.y + offset.y;
+    sf::Vector2f texTL(quad[0].texCoords),
+                 texBR(quad[2].texCoords);
+    if(clipping) {
+        float clipLeft = std::max(left, clip.left),
+              clipTop = std::max(top, clip.top),
+              clipRight = std::min(right, clip.left + clip.width),
+              clipBottom = std::min(bottom, clip.top + clip.height);
+        if((clipLeft >= clipRight) || (clipTop >= clipBottom))
+            return;
+        float texPerX = (texBR.x - texTL.x) / (right - left),
+              texPerY = (texBR.y - texTL.y) / (bottom - top);
+        texTL = sf::Vector2f(texTL.x + ((clipLeft - left) * texPerX), texTL.y + ((clipTop - top) * texPerY));
+        texBR = sf::Vector2f(texBR.x - ((right - clipRight) * texPerX), texBR.y - ((bottom - clipBottom) * texPerY));
+        left = clipLeft;
+        top = clipTop;
+        right = clipRight;
+        bottom = clipBottom;
+    }
+    vertexArray.append(sf::Vertex(sf::Vector2f(left, top), quad[0].color, texTL));
+    vertexArray.append(sf::Vertex(sf::Vector2f(right, top), quad[0].color, sf::Vector2f(texBR.x, texTL.y)));
+    vertexArray.append(sf::Vertex(sf::Vector2f(right, bottom), quad[0].color, texBR));
+    vertexArray.append(sf::Vertex(sf::Vector2f(left, bottom), quad[0].color, sf::Vector2f(texTL.x, texBR.y)));
+}
+
+void sfte::TextBatch::print(std::string_view toPrint, sf::Vector2f position, sf::Vector2f fontSize, size_t maxColumns, sf::Color color, bool shadowing, sf::Vector2f shadowOffset, float shadowFactor) {
+    sf::Vertex quads[8];
+    for(size_t c = 0, row = 0, column = 0, glyph = 0; c < toPrint.size(); ++c) {
+        if(toPrint[c] != '\n') {
+            size_t count = writeGlyph(quads, toPrint[c], sf::Vector2f(position.x + (column * fontSize.x), position.y + (row * fontSize.y)), fontSize, charBounds, color, shadowing, shadowOffset, shadowFactor) - quads;
+            for(size_t quad = 0; quad < count; quad += 4)
+                append(quads + quad, sf::Vector2f(0, 0));
+        }
+        advance(toPrint[c], maxColumns, row, column, glyph);
+    }
+}
+
+void sfte::TextBatch::add(const TextBlock& block) {
+    if(block.texture != texture)
+        throw std::invalid_argument("Cannot add a TextBlock with another font texture to a TextBatch!");
+    for(size_t n = 0; n + 4 <= block.vertexArray.getVertexCount(); n += 4)
+        append(&block.vertexArray[n], block.position);
+}
+
+void sfte::TextBatch::setClip(sf::FloatRect clipRect) {
+    clip = clipRect;
+    clipping = true;
+}
+
+void sfte::TextBatch::clearClip() {
+    clipping = false;
+}
+
+void sfte::TextBatch::draw(sf::RenderTarget* renderTarget) {
+    if(vertexArray.getVertexCount() > 0)
+        renderTarget->draw(vertexArray, texture);
+    clear();
+}
+
+void sfte::TextBatch::clear() {
+    vertexArray.clear(); // Keeps its memory
+}
+
+size_t sfte::TextBatch::getVertexCount() const {
+    return vertexArray.getVertexCount();
+}
+
+sfte::TextBatch::TextBatch(sf::Texture* fontTexture, sf::Vector2u characterBounds) :
+    texture(fontTexture),
+    charBounds(characterBounds),
+    vertexArray(sf::PrimitiveType::Quads)
+{}
\ No newline at end of file
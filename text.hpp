@@ -1,6 +1,8 @@
 #ifndef SFTE_TEXT_HPP
 #define SFTE_TEXT_HPP
 
+#include <string>
+#include <string_view>
 #include "core.hpp"
 
 namespace sfte {
@@ -11,7 +13,56 @@ namespace sfte {
 
 	public:
 		Text(sf::Texture* fontTexture, sf::Vector2u characterBounds);
-		void print(sf::RenderTarget* renderTarget, std::string toPrint, sf::Vector2f position, sf::Vector2f fontSize, size_t maxColumns = 0, sf::Color color = sf::Color::White, bool shadowing = false, sf::Vector2f shadowOffset = sf::Vector2f(1.0f, 1.0f), float shadowFactor = 1.0f);
+		void print(sf::RenderTarget* renderTarget, std::string_view toPrint, sf::Vector2f position, sf::Vector2f fontSize, size_t maxColumns = 0, sf::Color color = sf::Color::White, bool shadowing = false, sf::Vector2f shadowOffset = sf::Vector2f(1.0f, 1.0f), float shadowFactor = 1.0f);
+	};
+
+	class TextBlock { // Text which is laid out once and kept, for text drawn every frame. Only the characters which changed are laid out again.
+		sf::Texture* texture;
+		sf::Vector2u charBounds;
+		sf::VertexArray vertexArray;	// Quads relative to position, which is applied when drawing, so moving the block doesn't touch them.
+		std::string text;
+
+		sf::Vector2f position,
+					 fontSize;
+		size_t maxColumns;
+		sf::Color color;
+		bool shadowing;
+		sf::Vector2f shadowOffset;
+		float shadowFactor;
+
+		void layout(size_t from, size_t row, size_t column, size_t glyph); // Lay out text from the character from, which is the glyph-th one drawn, at row and column
+		friend class TextBatch;
+	public:
+		void setString(std::string_view string); // Characters replaced by other ones are updated alone. Everything after a change to a newline, or to the length, is laid out again.
+		const std::string& getString() const;
+		void setPosition(sf::Vector2f textPosition);
+		sf::Vector2f getPosition() const;
+		void setColor(sf::Color textColor);
+		void setStyle(sf::Vector2f textFontSize, size_t textMaxColumns = 0, bool textShadowing = false, sf::Vector2f textShadowOffset = sf::Vector2f(1.0f, 1.0f), float textShadowFactor = 1.0f); // Lays the whole block out again
+		void draw(sf::RenderTarget* renderTarget) const;
+
+		TextBlock(sf::Texture* fontTexture, sf::Vector2u characterBounds, sf::Vector2f textFontSize, size_t textMaxColumns = 0, sf::Color textColor = sf::Color::White, bool textShadowing = false, sf::Vector2f textShadowOffset = sf::Vector2f(1.0f, 1.0f), float textShadowFactor = 1.0f);
+	};
+
+	class TextBatch { // Collects the text of many prints and TextBlocks in one font, and draws all of it in one draw call
+		sf::Texture* texture;
+		sf::Vector2u charBounds;
+		sf::VertexArray vertexArray;	// Quads collected since the last draw. Keeps its memory between frames.
+		sf::FloatRect clip;				// Quads are cut to it on the CPU, so a single draw call can have many clip rectangles.
+		bool clipping = false;
+
+		void append(const sf::Vertex* quad, sf::Vector2f offset); // Append a quad moved by offset, cut to clip
+	public:
+		// Same as Text::print, but the quads are only drawn by draw
+		void print(std::string_view toPrint, sf::Vector2f position, sf::Vector2f fontSize, size_t maxColumns = 0, sf::Color color = sf::Color::White, bool shadowing = false, sf::Vector2f shadowOffset = sf::Vector2f(1.0f, 1.0f), float shadowFactor = 1.0f);
+		void add(const TextBlock& block); // block must use the batch's font texture
+		void setClip(sf::FloatRect clipRect); // For the prints and blocks added after it
+		void clearClip();
+		void draw(sf::RenderTarget* renderTarget); // Draw everything collected, then clear
+		void clear();
+		size_t getVertexCount() const;
+
+		TextBatch(sf::Texture* fontTexture, sf::Vector2u characterBounds);
 	};
 }
 
@@ -1,4 +1,5 @@
 #include "utils.hpp"
+#include <iterator>
 
 namespace sfte {
 	// sfte::Timer implementation
@@ -64,19 +65,21 @@ namespace sfte {
 		void Console::update() {
 			needsUpdate = false;
 			if(!str.empty()) {
-				std::vector < size_t > lVec;
+				// Only the last m_maxLines line ends are needed, so they are kept in a ring instead of a list of all of them
+				lineEnds.resize(m_maxLines + 1);
+				size_t lines = 0;
 				for(size_t n = 0, l = 0; n < str.size(); ++n) {
 					++l;
 					if((str[n] == '\n') || (l == m_maxColumns)) {
-						lVec.push_back(n);
+						lineEnds[lines++ % lineEnds.size()] = n;
 						l = 0;
 					}
 					else if(n + 1 == str.size())
-						lVec.push_back(n);
+						lineEnds[lines++ % lineEnds.size()] = n;
 				}
 
-				if(lVec.size() > m_maxLines)
-					str = str.substr(lVec[lVec.size() - m_maxLines - 1] + 1);
+				if(lines > m_maxLines)
+					str.erase(0, lineEnds[(lines - m_maxLines - 1) % lineEnds.size()] + 1); // Keeps the string's memory
 			}
 		}
 
@@ -92,7 +95,7 @@ namespace sfte {
 		    oldCout = std::cout.rdbuf(coutBuffer.rdbuf()); // Save old std::cout buffer pointer for later restore
 		}
 
-		Console& Console::operator<<(const std::string toInsert) {
+		Console& Console::operator<<(const std::string& toInsert) {
 			str += toInsert;
 			needsUpdate = true;
 			return *this;
@@ -191,15 +194,17 @@ namespace sfte {
 		void Console::render(sf::Vector2f position) {
 			// Update console with cout contents
 	        if(coutBuffer.rdbuf()->in_avail() > 0) {
-	            str += coutBuffer.str();
-	            coutBuffer.str("");
+	            str.append(std::istreambuf_iterator< char >(coutBuffer.rdbuf()), std::istreambuf_iterator< char >()); // Without copying it into a temporary string
+	            coutBuffer.str(std::string());
 	            coutBuffer.clear();
 	            needsUpdate = true;
 	        }
 
 			if(needsUpdate)
 				update();
-			textRenderer.print(currentRenderTarget, str, position, m_fontSize, m_maxColumns, m_color, m_shadowing, m_shadowOffset, m_shadowFactor);
+			textBlock.setString(str); // str is public, so it is compared even when nothing was inserted
+			textBlock.setPosition(position);
+			textBlock.draw(currentRenderTarget);
 		}
 
 		void Console::setRenderTarget(sf::RenderTarget* whereToDraw) {
@@ -208,7 +213,7 @@ namespace sfte {
 
 		Console::Console(sf::RenderTarget* whereToDraw, sf::Texture* fontTexture, sf::Vector2u characterBounds, sf::Vector2f fontSize, size_t maxLines, size_t maxColumns, sf::Color color, bool shadowing, sf::Vector2f shadowOffset, float shadowFactor) :
 			currentRenderTarget(whereToDraw),
-			textRenderer(fontTexture, characterBounds),
+			textBlock(fontTexture, characterBounds, fontSize, maxColumns, color, shadowing, shadowOffset, shadowFactor),
 			m_fontSize(fontSize),
 			m_maxLines(maxLines),
 			m_maxColumns(maxColumns),
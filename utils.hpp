@@ -32,8 +32,9 @@ namespace sfte {
 
 	class Console {
 		sf::RenderTarget* currentRenderTarget;
-		Text textRenderer;
+		TextBlock textBlock;	// str as drawn. Only laid out again where str changed.
 		bool needsUpdate = false;
+		std::vector < size_t > lineEnds;	// Used by update, kept to reuse its memory.
 		std::stringstream coutBuffer;
 		std::streambuf* oldCout = nullptr;
 
@@ -51,7 +52,7 @@ namespace sfte {
 		void update();
 		void restoreCout();
 		void redirectCout();
-		Console& operator<<(const std::string toInsert);
+		Console& operator<<(const std::string& toInsert);
 		Console& operator<<(const char* toInsert);
 		Console& operator<<(const bool toInsert);
 		Console& operator<<(const char toInsert);
@@ -1,4 +1,7 @@
 #include "world.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 namespace sfte {
 	// sfte::TileProperty implementation
@@ -9,4 +12,31 @@ namespace sfte {
 			visibility(visibilityMode),
 			connectiveID(connectsTo)
 		{}
+
+	// sfte::bitmaskKernel implementation
+		void bitmaskKernel(const unsigned char* centre, const unsigned char* left, const unsigned char* right, const unsigned char* top, const unsigned char* bottom, unsigned char* out, size_t count) {
+			size_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+			// 16 cells at a time. Each comparison gives 0x00 or 0xFF per cell, which is masked down to its bit.
+			const __m128i zero = _mm_setzero_si128(),
+						  leftBit = _mm_set1_epi8(8),
+						  rightBit = _mm_set1_epi8(2),
+						  topBit = _mm_set1_epi8(1),
+						  bottomBit = _mm_set1_epi8(4);
+			for(; i + 16 <= count; i += 16) {
+				__m128i c = _mm_loadu_si128((const __m128i*)(centre + i)),
+						mask = _mm_or_si128(_mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(left + i)), c), leftBit),
+														 _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(right + i)), c), rightBit)),
+											_mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(top + i)), c), topBit),
+														 _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(bottom + i)), c), bottomBit)));
+				_mm_storeu_si128((__m128i*)(out + i), _mm_andnot_si128(_mm_cmpeq_epi8(c, zero), mask)); // Cells which don't connect get no bitmask
+			}
+#endif
+			// Scalar fallback, also used for the cells left over by the SIMD loop
+			for(; i < count; ++i) {
+				unsigned char c = centre[i],
+							  mask = ((left[i] != c) << 3) | ((right[i] != c) << 1) | (top[i] != c) | ((bottom[i] != c) << 2);
+				out[i] = mask & -(unsigned char)(c != 0);
+			}
+		}
 }
\ No newline at end of file
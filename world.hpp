@@ -1,7 +1,18 @@
 #ifndef SFTE_WORLD_HPP
 #define SFTE_WORLD_HPP
 
+#include <stdexcept>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
 #include "core.hpp"
+#include "parallel.hpp"
+#include "memory.hpp"
+#include "worldfile.hpp"
+#include "containers.hpp"
 
 /*/////////////////////////////
 		Space in SFTE
@@ -23,6 +34,11 @@ namespace sfte {
 		visibilityTransparent
 	};
 
+	enum RenderMode {
+		renderVertexArray,	// Chunk geometry is kept in RAM and sent to the GPU on every draw.
+		renderVertexBuffer	// Chunk geometry is uploaded once to a static sf::VertexBuffer per chunk and only re-uploaded when it changes.
+	};
+
 	struct TileProperty {
 		sf::Vector2f tcTL, // TexCoord top left.
 					 tcBR; // TexCoord bottom right _DELTA_, NOT THE ACTUAL TEXCOORD! (so this is the difference between the BotRight and TopLeft texcoords!)
@@ -33,37 +49,151 @@ namespace sfte {
 		TileProperty(sf::Vector2f texCoordTopLeft, sf::Vector2f texCoordBottomRight, bool visible = true, VisibilityMode visibilityMode = visibilityTransparent, unsigned char connectsTo = 0);
 	};
 
+	// Compute count bitmasks at once from planes of connective IDs. centre holds the IDs of the cells themselves (0 for cells
+	// which never get a bitmask) and the other planes hold the IDs of their neighbour in each direction. Branch-free and SIMD on x86.
+	void bitmaskKernel(const unsigned char* centre, const unsigned char* left, const unsigned char* right, const unsigned char* top, const unsigned char* bottom, unsigned char* out, size_t count);
+
+	struct StreamingStats {
+		size_t residentChunks,	// Chunks with their tile data in memory.
+			   bytesUsed,		// Memory used by the resident chunks (tiles, bitmask, occluders and geometry) and the spilled ones.
+			   spilledChunks,	// Edited chunks which were evicted. Only their packed tiles are kept, to be installed again instead of the file's.
+			   queuedChunks,	// Chunks requested but not installed yet.
+			   failedChunks;	// Chunks which couldn't be loaded. They read as the default tile and aren't requested again.
+		double lastLoadLatency,	// Seconds from a chunk being requested to it being drawable, for the last chunk
+			   averageLoadLatency; // and on average.
+	};
+
 	template< typename tileIDType = size_t > class World {
+		static_assert(std::is_integral< tileIDType >::value && std::is_unsigned< tileIDType >::value, "World tile IDs must be an unsigned integer type"); // They index tables directly
 		// Class private members. These include implementation exclusive functions and private variables.
 		// Some members could be accessed directly, but it is more pretty to give them an access function.
 		std::vector< TileProperty >* tileProperties;							// Pointer to tile properties table.
+		struct TileLookup {														// Flattened copy of the tile properties table, indexed by tile ID,
+			std::vector< unsigned char > render,								// so the hot loops do one unchecked load per tile. Built by
+										 visibility,							// updateTileProperties.
+										 connectiveID;
+			std::vector< sf::Vector2f > texCoords;								// Corners (TL, TR, BR, BL) of the 16 bitmask variants of each tile.
+		} lookup;
 		sf::Vector3u tilemapSize,												// Size of the tilemap.
 					 tilemapLimits;												// Same as above but with -1, for convineance
 		sf::Vector2u tileSize;													// Size of each tile in pixels (for tile boundaries).
 		sf::Texture* tilemapTexture;											// Pointer to the texture to be used for tilemap rendering.
 		std::vector< sf::Color > layerColor;									// Color of tiles when in each layer.
 		sf::RenderTarget* currentRenderTarget;									// Pointer to the current render target (where to render).
-		std::vector< std::vector < std::vector < tileIDType > > > tilemap;		// Vector to store all of the tiles in the tilemap.
-		std::vector< std::vector < char > > occludermap;						// Occluder map.
-		std::vector< std::vector < std::vector < unsigned char > > > bitmask;	// Bitmask (for custom edges from texture atlas).
-		sf::VertexArray tilemapVA;												// The vertex array for the tilemap (contains geometry).
-																				// This is only kept for optimisation purposes.
-		bool redraw = false;													// This is also only for optimisations. Indicates VA redraw.
-		sf::Vector2f lastTlScreenPoint,											//                  ''                . Stores last screen points
-					 lastBrScreenPoint;											// to compare to the new ones.
+		tileIDType defaultID;													// Tile ID of every tile in a chunk which isn't resident.
+
+		struct Chunk {															// A chunkSize x chunkSize group of columns, with its own tile data and cached geometry.
+			PaletteArray< tileIDType > tiles;									// Tiles of the chunk, x outermost and z innermost, as indices into the chunk's own palette.
+			std::vector< unsigned char > bitmask;								// Bitmask (for custom edges from texture atlas). Same layout as tiles.
+			std::vector< std::uint8_t > occluders;								// Occluder map, one entry per column. Maps have at most 256 layers, so the top one fits.
+			std::vector< sf::Vertex > vertices;									// Geometry, one quad per tile.
+			std::unique_ptr< sf::VertexBuffer > buffer;							// GPU copy of vertices. Only made in renderVertexBuffer mode, so other modes need no OpenGL.
+			size_t bufferCount = 0;												// Number of vertices in buffer which belong to this chunk.
+			bool dirty = true;													// Indicates that the vertices have to be rebuilt before drawing.
+			bool resident = false;												// The tile data is in memory. Always true unless streaming.
+			bool requested = false;												// Streaming: a load is queued or running.
+			bool failed = false;												// Streaming: the load failed, so the chunk stays the default tile and is never requested again.
+			bool modified = false;												// Streaming: edited since it was loaded, so its tiles are spilled when it is evicted.
+			unsigned long lastUsed = 0;											// Streaming: last frame the chunk was near the view.
+			unsigned long revision = 0;											// Bumped whenever the tiles or bitmask change, so that data derived from them can tell it is stale.
+			std::chrono::steady_clock::time_point requestTime;					// Streaming: when the load was first requested.
+		};
+		RenderMode renderMode = renderVertexArray;								// How chunk geometry is drawn.
+		sf::Vector2u chunkCount;												// Number of chunks in each axis.
+		std::vector< Chunk > chunks;											// Every chunk, x major. Chunks on the right and bottom edges are padded to the full size.
+		std::vector< sf::Vector2u > rebuildList;								// Dirty chunks found by render, kept to reuse its memory.
+		FrameArena frameArena;													// Scratch memory of a render call. Reset when render starts.
+		unsigned int editDepth = 0;												// Number of beginEdit calls without a matching commitEdit.
+		std::vector< sf::Vector3u > pendingEdits;								// Tiles set since the outermost beginEdit.
+
+		struct ChunkLoad {														// A chunk decoded by the loader thread, waiting to be installed by render.
+			size_t chunk;
+			PaletteArray< tileIDType > tiles;
+			tileIDType maxID;
+			std::vector< unsigned char > bitmask;
+			std::vector< std::uint8_t > occluders;
+			std::exception_ptr error;
+		};
+		struct Streamer {														// Streaming state. Only exists for worlds made from a WorldFile.
+			const WorldFile* file;												// Where chunks are loaded from.
+			size_t memoryBudget;												// Bytes of chunk data to keep resident. Chunks near the view are kept even over budget.
+			std::thread loader;													// Background thread which decodes requested chunks.
+			std::mutex mutex;													// Guards requests, loaded and quit.
+			std::condition_variable wake;
+			std::deque< size_t > requests;										// Chunks to load, nearest to the view first.
+			std::vector< ChunkLoad > loaded;									// Chunks decoded by the loader.
+			std::vector< ChunkLoad > installing;								// Swapped with loaded by render, so the lock is held only for the swap.
+			bool quit = false;
+			unsigned long frame = 0;											// Number of render calls, used to find the least recently used chunk.
+			std::vector< size_t > resident;										// Indices of the resident chunks.
+			std::vector< size_t > wanted;										// Chunks near the view, kept to reuse its memory.
+			std::vector< size_t > evictable;									// Resident chunks which may be evicted, least recently used first. Same.
+			std::unordered_map< size_t, PaletteArray< tileIDType > > spilled;	// Tiles of evicted edited chunks, by chunk. Only touched by render, so not guarded.
+			size_t spilledBytes = 0;
+			size_t bytesUsed = 0;
+			size_t loads = 0,
+				   failures = 0;
+			double totalLatency = 0,
+				   lastLatency = 0;
+		};
+		std::unique_ptr< Streamer > streamer;
+
+		// Storage layout. Chunks are x major and each chunk's columns are x outermost. tileIndex is a
+		// key that is unique for every tile, in the same order as the tiles are in memory chunk by chunk.
+		inline size_t chunkIndex(sf::Vector2u position);
+		inline size_t tileIndex(sf::Vector3u position);
+		inline size_t columnIndex(sf::Vector2u position); // Column of a position within its chunk.
+		inline void readColumn(sf::Vector2u position, tileIDType* out); // Tiles of a column, or defaultID if its chunk isn't resident.
+
+		// Chunk related functions
+		inline void markDirty(sf::Vector2u position);
+		size_t countRow(sf::Vector2u chunkPosition, size_t y);
+		void buildRow(sf::Vector2u chunkPosition, size_t y, sf::Vertex* out);
+		void buildChunks(const std::vector< sf::Vector2u >& chunkPositions, size_t threads);
 
 		// Occluder map related functions
-		inline bool isOccluder(sf::Vector3u position);
+		inline bool isOccluder(const Chunk& chunk, size_t i);
 		inline void updateOccluder(sf::Vector2u position);
 
 		// Bitmask related functions
+		inline unsigned char calcBitmask(tileIDType ID, tileIDType left, tileIDType right, tileIDType top, tileIDType bottom);
 		inline void updateBitmask(sf::Vector3u position);
+
+		// Edit related functions
+		void applyEdit(sf::Vector3u position);
+		void applyPendingEdits();
+
+		// World file related functions
+		void checkFile(const WorldFile& file);
+		void readChunk(const WorldFile& file, size_t chunk, std::vector< tileIDType >& scratch);
+		void allocateChunk(Chunk& chunk);
+		void fixSeams(sf::Vector2u chunkPosition, bool planes);
+
+		// Streaming related functions
+		void loaderThread();
+		void updateStreaming(sf::Vector2u tlChunk, sf::Vector2u brChunk);
+		void installChunk(ChunkLoad& load);
+		void evictChunk(size_t n); // Frees the chunk's data, spilling its tiles if it was edited. The caller removes it from streamer->resident.
+		size_t chunkBytes(const Chunk& chunk);
 	public:
+		static const unsigned int chunkSize = 32; // Width and height of a chunk in columns.
+		static const unsigned int maxLayers = 256; // Occluder entries are bytes, so the constructors reject taller maps.
+
 		// More occluder map related functions
-		void genOccluderMap();
+		void genOccluderMap(size_t threads = 0); // Whole-map pass, split into bands of chunks over threads (0 = workerCount()).
 
 		// More bitmask related functions
-		void genBitmask();
+		void genBitmask(size_t threads = 0); // Whole-map pass, split into bands of chunks over threads (0 = workerCount()).
+
+		// Batched edits. Tiles set between beginEdit and commitEdit only have their bitmask and occluder
+		// data updated on commit, once per affected cell. Calls can be nested; only the outermost commit applies.
+		void beginEdit();
+		void commitEdit();
+
+		// World files (see worldfile.hpp). The file must have the same tilemap size as the world.
+		void save(const std::string& path, unsigned int flags = worldFileBitmask | worldFileOccluders); // flags: which precomputed planes to store
+		void load(const WorldFile& file, size_t threads = 0); // Whole tilemap. Planes missing from the file are generated.
+		void loadChunk(const WorldFile& file, sf::Vector2u chunkPosition); // One chunk, fixing up the bitmask and occluders along its seams.
 
 		// Member access
 		inline void		  tile(sf::Vector3u position, tileIDType ID);
@@ -73,14 +203,31 @@ namespace sfte {
 		inline sf::Vector3u getTilemapSize();
 		inline sf::Vector3u getTilemapLimits();
 		inline sf::Vector2u getTileSize();
+		unsigned long getRevision(sf::Vector2u tlPosition, sf::Vector2u brPosition); // Sum of the revisions of the chunks covering the area. Changes whenever a tile or bitmask in them does.
 
 		// Rendering
 		void setRenderTarget(sf::RenderTarget* newRenderTarget);
 		sf::RenderTarget* getRenderTarget();
 		void render(sf::Vector2f tlScreenPoint, sf::Vector2f brScreenPoint);
+		void redraw(); // Rebuild the geometry of every chunk on the next render.
+		void setRenderMode(RenderMode mode); // Falls back to renderVertexArray if vertex buffers aren't supported by the system.
+		RenderMode getRenderMode();
+		void updateTileProperties(); // Rebuild the tile property lookup table and redraw. Needed after changing the tile properties table.
 
-		// Constructor
+		// Streaming. Only chunks near the area given to render are resident; the rest are loaded from the
+		// world file by a background thread and evicted, least recently used first, to stay under the budget. Edited chunks
+		// keep their packed tiles in memory when evicted, which count towards the budget, so edits are never lost.
+		// Tiles of chunks which aren't resident read as the default ID and can't be set.
+		bool isStreaming();
+		bool isResident(sf::Vector2u position);
+		void setMemoryBudget(size_t bytes);
+		StreamingStats getStreamingStats();
+		static const unsigned int streamingMargin = 1; // Chunks around the view which are loaded ahead of time.
+
+		// Constructors
 		World(std::vector< TileProperty >* tilePropertiesPointer, sf::Vector3u mapSize, sf::Vector2u tileSizeInPixels, sf::Texture* tilemapTexturePointer, std::vector < sf::Color > layerColors, tileIDType defaultID = 0, sf::RenderTarget* whereToDraw = nullptr);
+		World(std::vector< TileProperty >* tilePropertiesPointer, const WorldFile* file, size_t memoryBudget, sf::Vector2u tileSizeInPixels, sf::Texture* tilemapTexturePointer, std::vector < sf::Color > layerColors, sf::RenderTarget* whereToDraw = nullptr); // Streaming world. file must outlive it.
+		~World();
 	};
 
 	/* sfte::World implementation. Because sfte::World is a template class it has to be implemented in the header, which is very ugly.
@@ -90,88 +237,656 @@ namespace sfte {
 			;
 		}
 	*/
-		template< typename tileIDType > inline bool World< tileIDType >::isOccluder(sf::Vector3u position) {
+		template< typename tileIDType > inline size_t World< tileIDType >::chunkIndex(sf::Vector2u position) {
+			return (size_t(position.x / chunkSize) * chunkCount.y) + (position.y / chunkSize);
+		}
+
+		template< typename tileIDType > inline size_t World< tileIDType >::tileIndex(sf::Vector3u position) {
+			sf::Vector2u column(position.x, position.y);
+			return (((chunkIndex(column) * chunkSize * chunkSize) + columnIndex(column)) * tilemapSize.z) + position.z;
+		}
+
+		template< typename tileIDType > inline size_t World< tileIDType >::columnIndex(sf::Vector2u position) {
+			return ((position.x % chunkSize) * chunkSize) + (position.y % chunkSize);
+		}
+
+		template< typename tileIDType > inline void World< tileIDType >::readColumn(sf::Vector2u position, tileIDType* out) {
+			const Chunk& chunk = chunks[chunkIndex(position)];
+			if(chunk.resident)
+				chunk.tiles.unpack(columnIndex(position) * tilemapSize.z, tilemapSize.z, out);
+			else
+				std::fill(out, out + tilemapSize.z, defaultID);
+		}
+
+		template< typename tileIDType > inline void World< tileIDType >::markDirty(sf::Vector2u position) {
+			Chunk& chunk = chunks[chunkIndex(position)];
+			chunk.dirty = true;
+			++chunk.revision;
+		}
+
+		template< typename tileIDType > inline bool World< tileIDType >::isOccluder(const Chunk& chunk, size_t i) {
 			// TODO: Implement visibilityTransparentEdges when bitmask is done
-			return tileProperties->at(tilemap[position.x][position.y][position.z]).render && (tileProperties->at(tilemap[position.x][position.y][position.z]).visibility == visibilityOpaque || (tileProperties->at(tilemap[position.x][position.y][position.z]).visibility == visibilityTransparentEdges && bitmask[position.x][position.y][position.z] == 0));
+			tileIDType ID = chunk.tiles[i];
+			return lookup.render[ID] && (lookup.visibility[ID] == visibilityOpaque || (lookup.visibility[ID] == visibilityTransparentEdges && chunk.bitmask[i] == 0));
 		}
 
 		template< typename tileIDType > inline void World< tileIDType >::updateOccluder(sf::Vector2u position) {
-			sf::Vector3u pos(position.x, position.y, 0);
-			for(; pos.z < tilemapSize.z; ++pos.z) {
-				if((pos.z + 1 == tilemapSize.z) || isOccluder(pos)) {
-					occludermap[pos.x][pos.y] = pos.z;
+			Chunk& chunk = chunks[chunkIndex(position)];
+			if(!chunk.resident)
+				return;
+			size_t column = columnIndex(position),
+				   i = column * tilemapSize.z;
+			for(size_t z = 0; z < tilemapSize.z; ++z, ++i) {
+				if((z + 1 == tilemapSize.z) || isOccluder(chunk, i)) {
+					chunk.occluders[column] = z;
 					break;
 				}
 			}
 		}
 
-		template< typename tileIDType > inline void World< tileIDType >::updateBitmask(sf::Vector3u position) {
+		template< typename tileIDType > inline unsigned char World< tileIDType >::calcBitmask(tileIDType ID, tileIDType left, tileIDType right, tileIDType top, tileIDType bottom) {
+			// Neighbours outside of the tilemap are passed as ID itself, so they always connect.
 			unsigned char whatMask = 0;
-            if(tileProperties->at(tilemap[position.x][position.y][position.z]).render && (tileProperties->at(tilemap[position.x][position.y][position.z]).connectiveID != 0)){
-            	unsigned char thisID = tileProperties->at(tilemap[position.x][position.y][position.z]).connectiveID;
-                if (position.x > 0) {
-                    if(tileProperties->at(tilemap[position.x - 1][position.y][position.z]).connectiveID != thisID) // Left
-                        whatMask += 8;
-                }
-                if (position.x < tilemapLimits.x) {
-                    if(tileProperties->at(tilemap[position.x + 1][position.y][position.z]).connectiveID != thisID) // Right
-                        whatMask += 2;
-                }
-                if (position.y > 0) {
-                    if(tileProperties->at(tilemap[position.x][position.y - 1][position.z]).connectiveID != thisID) // Top
-                        whatMask += 1;
-                }
-                if (position.y < tilemapLimits.y) {
-                    if(tileProperties->at(tilemap[position.x][position.y + 1][position.z]).connectiveID != thisID) // Bottom
-                        whatMask += 4;
-                }
+            if(lookup.render[ID] && (lookup.connectiveID[ID] != 0)){
+            	unsigned char thisID = lookup.connectiveID[ID];
+                if(lookup.connectiveID[left] != thisID) // Left
+                    whatMask += 8;
+                if(lookup.connectiveID[right] != thisID) // Right
+                    whatMask += 2;
+                if(lookup.connectiveID[top] != thisID) // Top
+                    whatMask += 1;
+                if(lookup.connectiveID[bottom] != thisID) // Bottom
+                    whatMask += 4;
             }
-            bitmask[position.x][position.y][position.z] = whatMask;
+            return whatMask;
+		}
+
+		template< typename tileIDType > inline void World< tileIDType >::updateBitmask(sf::Vector3u position) {
+			Chunk& chunk = chunks[chunkIndex(sf::Vector2u(position.x, position.y))];
+			if(!chunk.resident)
+				return;
+			size_t i = (columnIndex(sf::Vector2u(position.x, position.y)) * tilemapSize.z) + position.z;
+			tileIDType ID = chunk.tiles[i];
+			chunk.bitmask[i] = calcBitmask(ID,
+				(position.x > 0)				 ? tile(sf::Vector3u(position.x - 1, position.y, position.z)) : ID,
+				(position.x < tilemapLimits.x) ? tile(sf::Vector3u(position.x + 1, position.y, position.z)) : ID,
+				(position.y > 0)				 ? tile(sf::Vector3u(position.x, position.y - 1, position.z)) : ID,
+				(position.y < tilemapLimits.y) ? tile(sf::Vector3u(position.x, position.y + 1, position.z)) : ID);
 		}
 
-		template< typename tileIDType > void World< tileIDType >::genBitmask() {
-			sf::Vector3u pos(0, 0, 0);
-			for(; pos.x < tilemapSize.x; ++pos.x) {
-				for(; pos.y < tilemapSize.y; ++pos.y) {
-					for(; pos.z < tilemapSize.z; ++pos.z) {
-						updateBitmask(pos);
+		template< typename tileIDType > void World< tileIDType >::genBitmask(size_t threads) {
+			// Connective ID of every tile type with 0 for invisible tiles, which never get a bitmask.
+			std::vector< unsigned char > centreConnective(lookup.connectiveID.size());
+			for(size_t ID = 0; ID < centreConnective.size(); ++ID)
+				centreConnective[ID] = lookup.render[ID] ? lookup.connectiveID[ID] : 0;
+
+			parallelFor(0, chunkCount.x, [this, &centreConnective](size_t bandBegin, size_t bandEnd) {
+				// Planes of connective IDs for one chunk plus a border of one column on each side, in the same layout as the tilemap.
+				// Border columns outside of the tilemap repeat the nearest column inside, so the cells on the edge always connect to them.
+				size_t padded = chunkSize + 2;
+				std::vector< unsigned char > plane(padded * padded * tilemapSize.z),
+											 centrePlane(plane.size());
+				std::vector< tileIDType > column(tilemapSize.z),
+										  chunkTiles(size_t(chunkSize) * chunkSize * tilemapSize.z);
+				for(size_t cx = bandBegin; cx < bandEnd; ++cx) {
+					for(size_t cy = 0; cy < chunkCount.y; ++cy) {
+						Chunk& chunk = chunks[(cx * chunkCount.y) + cy];
+						if(!chunk.resident)
+							continue;
+						chunk.tiles.unpack(0, chunkTiles.size(), chunkTiles.data()); // Most columns are the chunk's own, so unpack it in one go
+						for(size_t px = 0; px < padded; ++px) {
+							size_t x = std::min(size_t(std::max(long(cx * chunkSize + px) - 1, 0L)), size_t(tilemapLimits.x));
+							for(size_t py = 0; py < padded; ++py) {
+								size_t y = std::min(size_t(std::max(long(cy * chunkSize + py) - 1, 0L)), size_t(tilemapLimits.y)),
+									   to = ((px * padded) + py) * tilemapSize.z;
+								const tileIDType* from = column.data();
+								if((x / chunkSize == cx) && (y / chunkSize == cy))
+									from = &chunkTiles[columnIndex(sf::Vector2u(x, y)) * tilemapSize.z];
+								else
+									readColumn(sf::Vector2u(x, y), column.data()); // Neighbours in chunks which aren't resident read as default tiles
+								for(size_t z = 0; z < tilemapSize.z; ++z) {
+									plane[to + z] = lookup.connectiveID[from[z]];
+									centrePlane[to + z] = centreConnective[from[z]];
+								}
+							}
+						}
+
+						++chunk.revision;
+
+						// Every row of the chunk is contiguous in both the planes and the bitmask, so each is done in one kernel call.
+						size_t rowLength = size_t(chunkSize) * tilemapSize.z;
+						unsigned char* out = chunk.bitmask.data();
+						for(size_t px = 1; px <= chunkSize; ++px, out += rowLength) {
+							size_t in = ((px * padded) + 1) * tilemapSize.z;
+							bitmaskKernel(&centrePlane[in], &plane[in - (padded * tilemapSize.z)], &plane[in + (padded * tilemapSize.z)], &plane[in - tilemapSize.z], &plane[in + tilemapSize.z], out, rowLength);
+						}
 					}
-					pos.z = 0;
 				}
-				pos.y = 0;
+			}, threads);
+			redraw();
+		}
+
+		template< typename tileIDType > void World< tileIDType >::genOccluderMap(size_t threads) {
+			// Occluder kind of every tile type: 0 never occludes, 1 always occludes, 2 occludes only when it has no edges.
+			std::vector< unsigned char > occluderKind(lookup.render.size());
+			for(size_t ID = 0; ID < occluderKind.size(); ++ID) {
+				if(lookup.render[ID] && (lookup.visibility[ID] == visibilityOpaque))
+					occluderKind[ID] = 1;
+				else if(lookup.render[ID] && (lookup.visibility[ID] == visibilityTransparentEdges))
+					occluderKind[ID] = 2;
 			}
+
+			parallelFor(0, chunkCount.x, [this, &occluderKind](size_t bandBegin, size_t bandEnd) {
+				std::vector< unsigned char > entryKind; // occluderKind of each palette entry of the chunk being visited
+				for(size_t cx = bandBegin * chunkSize; cx < std::min(bandEnd * chunkSize, size_t(tilemapSize.x)); cx += chunkSize) {
+					for(size_t cy = 0; cy < tilemapSize.y; cy += chunkSize) {
+						Chunk& chunk = chunks[((cx / chunkSize) * chunkCount.y) + (cy / chunkSize)];
+						if(!chunk.resident)
+							continue;
+						const std::vector< tileIDType >& palette = chunk.tiles.getPalette();
+						entryKind.resize(palette.size());
+						for(size_t entry = 0; entry < palette.size(); ++entry)
+							entryKind[entry] = occluderKind[palette[entry]];
+						// Visit the columns chunk by chunk, in storage order
+						for(size_t x = cx; x < std::min(cx + chunkSize, size_t(tilemapSize.x)); ++x) {
+							for(size_t y = cy; y < std::min(cy + chunkSize, size_t(tilemapSize.y)); ++y) {
+								size_t column = columnIndex(sf::Vector2u(x, y)),
+									   i = column * tilemapSize.z,
+									   z = 0;
+								for(; z + 1 < tilemapSize.z; ++z, ++i) {
+									unsigned char kind = entryKind[chunk.tiles.getIndex(i)];
+									if((kind == 1) || ((kind == 2) && (chunk.bitmask[i] == 0)))
+										break;
+								}
+								chunk.occluders[column] = z;
+							}
+						}
+					}
+				}
+			}, threads);
+			redraw();
 		}
 
-		template< typename tileIDType > void World< tileIDType >::genOccluderMap() {
-			sf::Vector3u pos(0, 0, 0);
-			for(; pos.x < tilemapSize.x; ++pos.x) {
-				for(; pos.y < tilemapSize.y; ++pos.y) {
-					for(; pos.z < tilemapSize.z; ++pos.z) {
-						if((pos.z + 1 == tilemapSize.z) || isOccluder(pos)) {
-							occludermap[pos.x][pos.y] = pos.z;
-							break;
+		template< typename tileIDType > void World< tileIDType >::applyEdit(sf::Vector3u position) {
+			// A tile affects its own bitmask and the bitmasks of its 4 neighbours in the same layer. Those in turn
+			// may change whether the neighbours are occluders, so their columns need a new occluder entry as well.
+			sf::Vector2u columns[5];
+			size_t n = 0;
+			columns[n++] = sf::Vector2u(position.x, position.y);
+			if(position.x > 0)
+				columns[n++] = sf::Vector2u(position.x - 1, position.y);
+			if(position.x < tilemapLimits.x)
+				columns[n++] = sf::Vector2u(position.x + 1, position.y);
+			if(position.y > 0)
+				columns[n++] = sf::Vector2u(position.x, position.y - 1);
+			if(position.y < tilemapLimits.y)
+				columns[n++] = sf::Vector2u(position.x, position.y + 1);
+
+			for(size_t c = 0; c < n; ++c)
+				updateBitmask(sf::Vector3u(columns[c].x, columns[c].y, position.z));
+			for(size_t c = 0; c < n; ++c) {
+				updateOccluder(columns[c]);
+				markDirty(columns[c]);
+			}
+		}
+
+		template< typename tileIDType > void World< tileIDType >::applyPendingEdits() {
+			// Very big batches (level streaming, for example) are cheaper to apply as a whole-map pass.
+			if(pendingEdits.size() > (size_t(tilemapSize.x) * tilemapSize.y * tilemapSize.z) / 8) {
+				pendingEdits.clear();
+				genBitmask();
+				genOccluderMap();
+				return;
+			}
+
+			// Gather every cell whose bitmask may have changed, merging the ones shared between edits
+			std::vector< std::pair< size_t, sf::Vector3u > > cells; // Buffer index and position of each cell
+			cells.reserve(pendingEdits.size() * 5);
+			for(sf::Vector3u position : pendingEdits) {
+				cells.push_back(std::make_pair(tileIndex(position), position));
+				if(position.x > 0)
+					cells.push_back(std::make_pair(tileIndex(sf::Vector3u(position.x - 1, position.y, position.z)), sf::Vector3u(position.x - 1, position.y, position.z)));
+				if(position.x < tilemapLimits.x)
+					cells.push_back(std::make_pair(tileIndex(sf::Vector3u(position.x + 1, position.y, position.z)), sf::Vector3u(position.x + 1, position.y, position.z)));
+				if(position.y > 0)
+					cells.push_back(std::make_pair(tileIndex(sf::Vector3u(position.x, position.y - 1, position.z)), sf::Vector3u(position.x, position.y - 1, position.z)));
+				if(position.y < tilemapLimits.y)
+					cells.push_back(std::make_pair(tileIndex(sf::Vector3u(position.x, position.y + 1, position.z)), sf::Vector3u(position.x, position.y + 1, position.z)));
+			}
+			pendingEdits.clear();
+			auto byIndex = [](const std::pair< size_t, sf::Vector3u >& a, const std::pair< size_t, sf::Vector3u >& b) { return a.first < b.first; };
+			auto sameIndex = [](const std::pair< size_t, sf::Vector3u >& a, const std::pair< size_t, sf::Vector3u >& b) { return a.first == b.first; };
+			std::sort(cells.begin(), cells.end(), byIndex);
+			cells.erase(std::unique(cells.begin(), cells.end(), sameIndex), cells.end());
+
+			for(const std::pair< size_t, sf::Vector3u >& cell : cells)
+				updateBitmask(cell.second);
+
+			// Update the occluder entry of every column touched, once. Cells are sorted by buffer index, which is
+			// column major, so cells of the same column are next to each other.
+			size_t lastColumn = size_t(-1);
+			for(const std::pair< size_t, sf::Vector3u >& cell : cells) {
+				size_t column = cell.first / tilemapSize.z;
+				if(column == lastColumn)
+					continue;
+				lastColumn = column;
+				updateOccluder(sf::Vector2u(cell.second.x, cell.second.y));
+				markDirty(sf::Vector2u(cell.second.x, cell.second.y));
+			}
+		}
+
+		template< typename tileIDType > void World< tileIDType >::beginEdit() {
+			++editDepth;
+		}
+
+		template< typename tileIDType > void World< tileIDType >::commitEdit() {
+			if(editDepth == 0)
+				throw std::logic_error("World::commitEdit called without a matching beginEdit!");
+			if(--editDepth == 0)
+				applyPendingEdits();
+		}
+
+		template< typename tileIDType > void World< tileIDType >::checkFile(const WorldFile& file) {
+			if(file.getTilemapSize() != tilemapSize)
+				throw std::runtime_error("World file tilemap size doesn't match the world! File: " + std::to_string(file.getHeader().size[0]) + "x" + std::to_string(file.getHeader().size[1]) + "x" + std::to_string(file.getHeader().size[2]));
+			if(file.getHeader().chunkSize != chunkSize)
+				throw std::runtime_error("World file chunk size doesn't match the world! File: " + std::to_string(file.getHeader().chunkSize));
+		}
+
+		template< typename tileIDType > void World< tileIDType >::readChunk(const WorldFile& file, size_t chunk, std::vector< tileIDType >& scratch) {
+			// The chunk is decoded and checked before anything is written, so a bad file never leaves invalid IDs in the tilemap.
+			size_t columns = size_t(chunkSize) * chunkSize,
+				   volume = columns * tilemapSize.z;
+			scratch.resize(volume);
+			file.decodeChunkTiles(chunk, scratch.data());
+			for(tileIDType ID : scratch) {
+				if(size_t(ID) >= lookup.render.size())
+					throw std::out_of_range("Tile ID in world file has no entry in the tile properties table! ID = " + std::to_string(size_t(ID)));
+			}
+
+			// Chunks are stored in the same layout in the file and in memory
+			Chunk& target = chunks[chunk];
+			if(!target.resident)
+				allocateChunk(target);
+			target.tiles.assign(scratch.data(), volume);
+			if(const unsigned char* plane = file.getChunkBitmask(chunk))
+				std::copy(plane, plane + volume, target.bitmask.begin());
+			if(const unsigned char* plane = file.getChunkOccluders(chunk))
+				std::copy(plane, plane + columns, target.occluders.begin());
+			target.dirty = true;
+			target.modified = false;
+			++target.revision;
+		}
+
+		template< typename tileIDType > void World< tileIDType >::allocateChunk(Chunk& chunk) {
+			size_t columns = size_t(chunkSize) * chunkSize;
+			chunk.tiles.assign(columns * tilemapSize.z, defaultID);
+			chunk.bitmask.assign(columns * tilemapSize.z, 0);
+			chunk.occluders.assign(columns, 0);
+			chunk.resident = true;
+		}
+
+		template< typename tileIDType > void World< tileIDType >::fixSeams(sf::Vector2u chunkPosition, bool planes) {
+			// Recompute the cells of a newly loaded or evicted chunk whose data may be stale, as an edit batch, which also updates the cells
+			// across the seams. Without precomputed planes every cell is stale. With them only the cells along a seam with a resident chunk can be
+			// (that chunk may differ from the file); along other seams the file's planes were made with the real neighbours, so they are kept.
+			sf::Vector3u start(chunkPosition.x * chunkSize, chunkPosition.y * chunkSize, 0),
+						 end(std::min(start.x + chunkSize, size_t(tilemapSize.x)), std::min(start.y + chunkSize, size_t(tilemapSize.y)), tilemapSize.z);
+			bool left = (chunkPosition.x > 0) && chunks[(size_t(chunkPosition.x - 1) * chunkCount.y) + chunkPosition.y].resident,
+				 right = (chunkPosition.x + 1 < chunkCount.x) && chunks[(size_t(chunkPosition.x + 1) * chunkCount.y) + chunkPosition.y].resident,
+				 top = (chunkPosition.y > 0) && chunks[(size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y - 1].resident,
+				 bottom = (chunkPosition.y + 1 < chunkCount.y) && chunks[(size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y + 1].resident;
+			beginEdit();
+			for(sf::Vector3u pos(start.x, start.y, 0); pos.x < end.x; ++pos.x) {
+				for(pos.y = start.y; pos.y < end.y; ++pos.y) {
+					if(planes && !((left && (pos.x == start.x)) || (right && (pos.x + 1 == end.x)) || (top && (pos.y == start.y)) || (bottom && (pos.y + 1 == end.y))))
+						continue;
+					for(pos.z = 0; pos.z < end.z; ++pos.z)
+						pendingEdits.push_back(pos);
+				}
+			}
+			commitEdit();
+		}
+
+		template< typename tileIDType > void World< tileIDType >::save(const std::string& path, unsigned int flags) {
+			for(const Chunk& chunk : chunks) {
+				if(!chunk.resident)
+					throw std::logic_error("Can't save a world with chunks which aren't resident!");
+			}
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			if(!file)
+				throw std::runtime_error("Couldn't open world file for writing! path = " + path);
+
+			WorldFileHeader header = { { 'S', 'F', 'T', 'W' }, WorldFile::version, sizeof(tileIDType), flags & (worldFileBitmask | worldFileOccluders),
+									   { std::uint32_t(tilemapSize.x), std::uint32_t(tilemapSize.y), std::uint32_t(tilemapSize.z) }, chunkSize, { chunkCount.x, chunkCount.y } };
+			std::vector< WorldFileChunk > table(chunks.size());
+			std::vector< unsigned char > stored(WorldFile::headerBytes + (table.size() * WorldFile::chunkEntryBytes), 0); // Header and table as they are in the file
+			WorldFile::storeHeader(header, stored.data());
+			file.write(reinterpret_cast< const char* >(stored.data()), stored.size()); // The table is filled in after the chunks
+
+			// Chunk data, in chunk order. Padding columns of edge chunks are stored too, so every chunk has the same layout as in memory.
+			std::uint64_t offset = stored.size();
+			std::vector< unsigned char > encoded;
+			std::vector< tileIDType > tiles(size_t(chunkSize) * chunkSize * tilemapSize.z);
+			for(size_t c = 0; c < chunks.size(); ++c) {
+				const Chunk& chunk = chunks[c];
+				chunk.tiles.unpack(0, tiles.size(), tiles.data());
+				table[c].offset = offset;
+				table[c].encoding = encodeChunkTiles(tiles.data(), tiles.size(), encoded);
+				table[c].tileBytes = encoded.size();
+				file.write(reinterpret_cast< const char* >(encoded.data()), encoded.size());
+				offset += encoded.size();
+				if(header.flags & worldFileBitmask) {
+					file.write(reinterpret_cast< const char* >(chunk.bitmask.data()), chunk.bitmask.size());
+					offset += chunk.bitmask.size();
+				}
+				if(header.flags & worldFileOccluders) {
+					file.write(reinterpret_cast< const char* >(chunk.occluders.data()), chunk.occluders.size());
+					offset += chunk.occluders.size();
+				}
+			}
+
+			for(size_t c = 0; c < table.size(); ++c)
+				WorldFile::storeChunkEntry(table[c], &stored[WorldFile::headerBytes + (c * WorldFile::chunkEntryBytes)]);
+			file.seekp(WorldFile::headerBytes);
+			file.write(reinterpret_cast< const char* >(&stored[WorldFile::headerBytes]), table.size() * WorldFile::chunkEntryBytes);
+			if(!file)
+				throw std::runtime_error("Couldn't write world file! path = " + path);
+		}
+
+		template< typename tileIDType > void World< tileIDType >::load(const WorldFile& file, size_t threads) {
+			if(streamer)
+				throw std::logic_error("Can't load a world file into a streaming world!");
+			checkFile(file);
+			parallelFor(0, chunks.size(), [this, &file](size_t bandBegin, size_t bandEnd) {
+				std::vector< tileIDType > scratch;
+				for(size_t chunk = bandBegin; chunk < bandEnd; ++chunk)
+					readChunk(file, chunk, scratch);
+			}, threads);
+			if(!file.hasBitmask())
+				genBitmask(threads);
+			if(!file.hasOccluders())
+				genOccluderMap(threads); // Needs the bitmask, so it always comes after it
+		}
+
+		template< typename tileIDType > void World< tileIDType >::loadChunk(const WorldFile& file, sf::Vector2u chunkPosition) {
+			if(streamer)
+				throw std::logic_error("Can't load a world file into a streaming world!");
+			checkFile(file);
+			if((chunkPosition.x >= chunkCount.x) || (chunkPosition.y >= chunkCount.y))
+				throw std::out_of_range("Chunk position out of range! x = " + std::to_string(chunkPosition.x) + ", y = " + std::to_string(chunkPosition.y));
+			std::vector< tileIDType > scratch;
+			readChunk(file, (size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y, scratch);
+			fixSeams(chunkPosition, file.hasBitmask() && file.hasOccluders());
+		}
+
+		template< typename tileIDType > void World< tileIDType >::loaderThread() {
+			// Decoding reads the mapped file, so this thread is where the disk is actually read. The lock is never held while decoding.
+			size_t columns = size_t(chunkSize) * chunkSize,
+				   volume = columns * tilemapSize.z;
+			std::vector< tileIDType > scratch;
+			std::unique_lock< std::mutex > lock(streamer->mutex);
+			while(true) {
+				streamer->wake.wait(lock, [this]() { return streamer->quit || !streamer->requests.empty(); });
+				if(streamer->quit)
+					return;
+				ChunkLoad load;
+				load.chunk = streamer->requests.front();
+				streamer->requests.pop_front();
+				lock.unlock();
+
+				try {
+					scratch.resize(volume);
+					streamer->file->decodeChunkTiles(load.chunk, scratch.data());
+					load.maxID = *std::max_element(scratch.begin(), scratch.end()); // Checked against the tile properties on install, as they may change meanwhile
+					load.tiles.assign(scratch.data(), volume); // Palette the chunk here rather than on the main thread
+					if(const unsigned char* plane = streamer->file->getChunkBitmask(load.chunk))
+						load.bitmask.assign(plane, plane + volume);
+					if(const unsigned char* plane = streamer->file->getChunkOccluders(load.chunk))
+						load.occluders.assign(plane, plane + columns);
+				}
+				catch(...) {
+					load.error = std::current_exception();
+				}
+
+				lock.lock();
+				streamer->loaded.push_back(std::move(load));
+			}
+		}
+
+		template< typename tileIDType > void World< tileIDType >::updateStreaming(sf::Vector2u tlChunk, sf::Vector2u brChunk) {
+			Streamer& stream = *streamer;
+			++stream.frame;
+
+			// Take the chunks the loader finished. Queued chunks are requeued below, in the order of the current view.
+			{
+				std::lock_guard< std::mutex > lock(stream.mutex);
+				stream.installing.swap(stream.loaded);
+				for(size_t chunk : stream.requests)
+					chunks[chunk].requested = false;
+				stream.requests.clear();
+			}
+			std::exception_ptr error;
+			for(ChunkLoad& load : stream.installing) {
+				try {
+					installChunk(load);
+				}
+				catch(...) {
+					if(!error)
+						error = std::current_exception();
+				}
+			}
+			stream.installing.clear();
+
+			// Chunks in view and within streamingMargin of it
+			unsigned int margin = streamingMargin;
+			sf::Vector2u from(tlChunk.x - std::min(tlChunk.x, margin), tlChunk.y - std::min(tlChunk.y, margin)),
+						 to(std::min(brChunk.x + margin, chunkCount.x - 1), std::min(brChunk.y + margin, chunkCount.y - 1));
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			stream.wanted.clear();
+			for(size_t x = from.x; x <= to.x; ++x) {
+				for(size_t y = from.y; y <= to.y; ++y) {
+					Chunk& chunk = chunks[(x * chunkCount.y) + y];
+					if(!chunk.resident && !chunk.requested && !chunk.failed) {
+						if((chunk.lastUsed == 0) || (chunk.lastUsed + 1 < stream.frame)) // Not wanted in the previous frame, so this is a new request
+							chunk.requestTime = now;
+						typename std::unordered_map< size_t, PaletteArray< tileIDType > >::iterator spill = stream.spilled.find((x * chunkCount.y) + y);
+						if(spill != stream.spilled.end()) { // Edited before, so its tiles are here rather than in the file. Nothing to decode.
+							ChunkLoad load;
+							load.chunk = spill->first;
+							load.maxID = 0; // Its IDs were checked when they were set
+							stream.spilledBytes -= spill->second.memoryUsage();
+							load.tiles = std::move(spill->second);
+							stream.spilled.erase(spill);
+							installChunk(load);
+							chunk.modified = true;
 						}
+						else
+							stream.wanted.push_back((x * chunkCount.y) + y);
+					}
+					chunk.lastUsed = stream.frame;
+				}
+			}
+
+			// Evict the least recently used chunks until the budget is met. Chunks near the view are kept.
+			stream.bytesUsed = stream.spilledBytes;
+			for(size_t chunk : stream.resident)
+				stream.bytesUsed += chunkBytes(chunks[chunk]);
+			if(stream.bytesUsed > stream.memoryBudget) {
+				// One sort of the candidates, then a single pass to drop the evicted chunks from resident
+				stream.evictable.clear();
+				for(size_t chunk : stream.resident) {
+					if(chunks[chunk].lastUsed != stream.frame)
+						stream.evictable.push_back(chunk);
+				}
+				std::sort(stream.evictable.begin(), stream.evictable.end(), [this](size_t a, size_t b) {
+					return chunks[a].lastUsed < chunks[b].lastUsed;
+				});
+				for(size_t n = 0; (n < stream.evictable.size()) && (stream.bytesUsed > stream.memoryBudget); ++n) {
+					size_t spilledBefore = stream.spilledBytes;
+					stream.bytesUsed -= chunkBytes(chunks[stream.evictable[n]]);
+					evictChunk(stream.evictable[n]);
+					stream.bytesUsed += stream.spilledBytes - spilledBefore;
+				}
+				stream.resident.erase(std::remove_if(stream.resident.begin(), stream.resident.end(), [this](size_t chunk) {
+					return !chunks[chunk].resident;
+				}), stream.resident.end());
+			}
+
+			// Queue the missing chunks, nearest to the centre of the view first
+			float centreX = (tlChunk.x + brChunk.x) / 2.f,
+				  centreY = (tlChunk.y + brChunk.y) / 2.f;
+			size_t height = chunkCount.y;
+			std::sort(stream.wanted.begin(), stream.wanted.end(), [centreX, centreY, height](size_t a, size_t b) {
+				float ax = (a / height) - centreX, ay = (a % height) - centreY,
+					  bx = (b / height) - centreX, by = (b % height) - centreY;
+				return (ax * ax) + (ay * ay) < (bx * bx) + (by * by);
+			});
+			if(!stream.wanted.empty()) {
+				{
+					std::lock_guard< std::mutex > lock(stream.mutex);
+					for(size_t chunk : stream.wanted) {
+						chunks[chunk].requested = true;
+						stream.requests.push_back(chunk);
 					}
-					pos.z = 0;
 				}
-				pos.y = 0;
+				stream.wake.notify_one();
+			}
+
+			if(error)
+				std::rethrow_exception(error);
+		}
+
+		template< typename tileIDType > void World< tileIDType >::installChunk(ChunkLoad& load) {
+			Chunk& chunk = chunks[load.chunk];
+			chunk.requested = false;
+			if(load.error || (size_t(load.maxID) >= lookup.render.size())) {
+				// Reported once, by the render call which installs it. Retrying would only fail again every frame.
+				chunk.failed = true;
+				++streamer->failures;
+				if(load.error)
+					std::rethrow_exception(load.error);
+				throw std::out_of_range("Tile ID in world file has no entry in the tile properties table! ID = " + std::to_string(size_t(load.maxID)));
+			}
+
+			size_t columns = size_t(chunkSize) * chunkSize;
+			bool planes = !load.bitmask.empty() && !load.occluders.empty(); // Spilled chunks come without them
+			chunk.tiles = std::move(load.tiles);
+			if(load.bitmask.empty())
+				chunk.bitmask.assign(columns * tilemapSize.z, 0);
+			else
+				chunk.bitmask.swap(load.bitmask);
+			if(load.occluders.empty())
+				chunk.occluders.assign(columns, 0);
+			else
+				chunk.occluders.swap(load.occluders);
+			chunk.resident = true;
+			chunk.modified = false;
+			chunk.dirty = true;
+			++chunk.revision;
+			streamer->resident.push_back(load.chunk);
+
+			streamer->lastLatency = std::chrono::duration< double >(std::chrono::steady_clock::now() - chunk.requestTime).count();
+			streamer->totalLatency += streamer->lastLatency;
+			++streamer->loads;
+
+			fixSeams(sf::Vector2u(load.chunk / chunkCount.y, load.chunk % chunkCount.y), planes);
+		}
+
+		template< typename tileIDType > void World< tileIDType >::evictChunk(size_t n) {
+			Chunk& chunk = chunks[n];
+
+			// Keep the tiles of an edited chunk, the file has the old ones. Swap with empty vectors, as clear doesn't free the memory.
+			if(chunk.modified) {
+				streamer->spilledBytes += chunk.tiles.memoryUsage();
+				streamer->spilled[n] = std::move(chunk.tiles);
+				chunk.modified = false;
 			}
+			chunk.tiles.clear();
+			std::vector< unsigned char >().swap(chunk.bitmask);
+			std::vector< std::uint8_t >().swap(chunk.occluders);
+			std::vector< sf::Vertex >().swap(chunk.vertices);
+			chunk.buffer.reset();
+			chunk.bufferCount = 0;
+			chunk.resident = false;
+			chunk.dirty = true;
+			++chunk.revision; // Its tiles read as the default ID now
+
+			// The resident neighbours' seam cells were computed against the tiles which are gone
+			fixSeams(sf::Vector2u(n / chunkCount.y, n % chunkCount.y), true);
+		}
+
+		template< typename tileIDType > size_t World< tileIDType >::chunkBytes(const Chunk& chunk) {
+			return chunk.tiles.memoryUsage() + chunk.bitmask.capacity() + chunk.occluders.capacity() + (chunk.vertices.capacity() * sizeof(sf::Vertex));
+		}
+
+		template< typename tileIDType > bool World< tileIDType >::isStreaming() {
+			return bool(streamer);
+		}
+
+		template< typename tileIDType > bool World< tileIDType >::isResident(sf::Vector2u position) {
+			return chunks[chunkIndex(position)].resident;
+		}
+
+		template< typename tileIDType > void World< tileIDType >::setMemoryBudget(size_t bytes) {
+			if(streamer)
+				streamer->memoryBudget = bytes;
+		}
+
+		template< typename tileIDType > StreamingStats World< tileIDType >::getStreamingStats() {
+			StreamingStats stats = {};
+			if(!streamer) {
+				stats.residentChunks = chunks.size();
+				for(const Chunk& chunk : chunks)
+					stats.bytesUsed += chunkBytes(chunk);
+				return stats;
+			}
+			stats.residentChunks = streamer->resident.size();
+			stats.bytesUsed = streamer->spilledBytes;
+			for(size_t chunk : streamer->resident)
+				stats.bytesUsed += chunkBytes(chunks[chunk]);
+			stats.spilledChunks = streamer->spilled.size();
+			{
+				std::lock_guard< std::mutex > lock(streamer->mutex);
+				stats.queuedChunks = streamer->requests.size() + streamer->loaded.size();
+			}
+			stats.failedChunks = streamer->failures;
+			stats.lastLoadLatency = streamer->lastLatency;
+			stats.averageLoadLatency = (streamer->loads > 0) ? streamer->totalLatency / streamer->loads : 0;
+			return stats;
 		}
 
 		template< typename tileIDType > inline void World< tileIDType >::tile(sf::Vector3u position, tileIDType ID) {
-			tilemap[position.x][position.y][position.z] = ID; // Set tile ID of requested position to specified value.
+			// IDs are checked here once, so that reading them back never needs a bounds check.
+			if(size_t(ID) >= lookup.render.size())
+				throw std::out_of_range("Tile ID has no entry in the tile properties table! ID = " + std::to_string(size_t(ID)));
+			sf::Vector2u column(position.x, position.y);
+			Chunk& chunk = chunks[chunkIndex(column)];
+			if(!chunk.resident)
+				throw std::logic_error("Can't set a tile in a chunk which isn't resident! x = " + std::to_string(position.x) + ", y = " + std::to_string(position.y));
+			chunk.tiles.set((columnIndex(column) * tilemapSize.z) + position.z, ID); // Set tile ID of requested position to specified value.
+			chunk.modified = true;
+			++chunk.revision;
+			if(editDepth > 0)
+				pendingEdits.push_back(position); // Bitmask and occluder data is updated on commit
+			else
+				applyEdit(position);
 		}
 
 		template< typename tileIDType > inline tileIDType World< tileIDType >::tile(sf::Vector3u position) {
-			return tilemap[position.x][position.y][position.z]; // Return tile ID of requested position.
+			sf::Vector2u column(position.x, position.y);
+			const Chunk& chunk = chunks[chunkIndex(column)];
+			return chunk.resident ? chunk.tiles[(columnIndex(column) * tilemapSize.z) + position.z] : defaultID; // Return tile ID of requested position.
 		}
 
 		template< typename tileIDType > inline TileProperty World< tileIDType >::getTileProperties(sf::Vector3u position) {
-			return tileProperties->at(tilemap[position.x][position.y][position.z]); // Return tile properties of requested position.
+			return tileProperties->at(tile(position)); // Return tile properties of requested position.
 		}
 
 		template< typename tileIDType > inline unsigned char World< tileIDType >::getTileBitmask(sf::Vector3u position) {
-			return bitmask[position.x][position.y][position.z]; // Return tile bitmask of requested position.
+			sf::Vector2u column(position.x, position.y);
+			const Chunk& chunk = chunks[chunkIndex(column)];
+			return chunk.resident ? chunk.bitmask[(columnIndex(column) * tilemapSize.z) + position.z] : 0; // Return tile bitmask of requested position.
 		}
 
 		template< typename tileIDType > inline sf::Vector3u World< tileIDType >::getTilemapSize() {
@@ -182,11 +897,124 @@ namespace sfte {
 			return tilemapLimits; // Return tilemap limits.
 		}
 
+		template< typename tileIDType > unsigned long World< tileIDType >::getRevision(sf::Vector2u tlPosition, sf::Vector2u brPosition) {
+			// Revisions only ever grow, so the sum changes whenever any of them does
+			size_t right = std::min(size_t(brPosition.x), size_t(tilemapLimits.x)),
+				   bottom = std::min(size_t(brPosition.y), size_t(tilemapLimits.y));
+			unsigned long revision = 0;
+			for(size_t x = tlPosition.x / chunkSize; x <= right / chunkSize; ++x) {
+				for(size_t y = tlPosition.y / chunkSize; y <= bottom / chunkSize; ++y)
+					revision += chunks[(x * chunkCount.y) + y].revision;
+			}
+			return revision;
+		}
+
 		template< typename tileIDType > inline sf::Vector2u World< tileIDType >::getTileSize() {
 			return tileSize; // Return tile size.
 		}
 
+		template< typename tileIDType > size_t World< tileIDType >::countRow(sf::Vector2u chunkPosition, size_t y) {
+			// Number of quads buildRow writes for the same row
+			const Chunk& chunk = chunks[(size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y];
+			size_t count = 0,
+				   xStart = chunkPosition.x * chunkSize,
+				   xEnd = std::min(xStart + chunkSize, size_t(tilemapSize.x));
+			if(y >= tilemapSize.y)
+				return 0;
+			Scratch< tileIDType > tiles; // One column's layers, up to the occluder
+			tiles->resize(tilemapSize.z);
+			for(size_t x = xStart; x < xEnd; ++x) {
+				size_t column = ((x - xStart) * chunkSize) + (y % chunkSize);
+				chunk.tiles.unpack(column * tilemapSize.z, chunk.occluders[column] + 1, tiles->data());
+				for(int z = chunk.occluders[column]; z >= 0; --z)
+					count += lookup.render[(*tiles)[z]];
+			}
+			return count;
+		}
+
+		template< typename tileIDType > void World< tileIDType >::buildRow(sf::Vector2u chunkPosition, size_t y, sf::Vertex* out) {
+			// Calculate geometry data of one row of a chunk, straight into its place in the chunk's vertices
+			const Chunk& chunk = chunks[(size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y];
+			size_t xStart = chunkPosition.x * chunkSize,
+				   xEnd = std::min(xStart + chunkSize, size_t(tilemapSize.x));
+			if(y >= tilemapSize.y)
+				return;
+			Scratch< tileIDType > tiles; // Same as in countRow
+			tiles->resize(tilemapSize.z);
+			for(size_t x = xStart; x < xEnd; ++x) {
+				size_t column = ((x - xStart) * chunkSize) + (y % chunkSize);
+				chunk.tiles.unpack(column * tilemapSize.z, chunk.occluders[column] + 1, tiles->data());
+				const unsigned char* masks = &chunk.bitmask[column * tilemapSize.z];
+				for(int z = chunk.occluders[column]; z >= 0; --z) {
+					tileIDType ID = (*tiles)[z];
+					if(lookup.render[ID]) {
+						const sf::Vector2f* texCoords = &lookup.texCoords[((size_t(ID) * 16) + masks[z]) * 4]; // TL, TR, BR, BL
+						float left = x * tileSize.x,
+							  top = y * tileSize.y,
+							  right = left + tileSize.x,
+							  bottom = top + tileSize.y;
+						*out++ = sf::Vertex(sf::Vector2f(left , top	), layerColor[z], texCoords[0]); // TL
+						*out++ = sf::Vertex(sf::Vector2f(right, top	), layerColor[z], texCoords[1]); // TR
+						*out++ = sf::Vertex(sf::Vector2f(right, bottom), layerColor[z], texCoords[2]); // BR
+						*out++ = sf::Vertex(sf::Vector2f(left , bottom), layerColor[z], texCoords[3]); // BL
+					}
+				}
+			}
+		}
+
+		template< typename tileIDType > void World< tileIDType >::buildChunks(const std::vector< sf::Vector2u >& chunkPositions, size_t threads) {
+			// Geometry is built in three steps so that rows can be written in parallel without any vertex vector growing:
+			// 1 - Count the quads of every row of every chunk
+			// 2 - Prefix sum the counts of each chunk to get where each row starts, and size the chunk's vertices once
+			// 3 - Write every row at its place
+			// The output is exactly the same as writing the rows one after another.
+			size_t rows = chunkPositions.size() * chunkSize;
+			size_t* rowStart = frameArena.allocate< size_t >(rows);
+
+			// Step 1
+			parallelFor(0, rows, [this, &chunkPositions, rowStart](size_t bandBegin, size_t bandEnd) {
+				for(size_t row = bandBegin; row < bandEnd; ++row)
+					rowStart[row] = countRow(chunkPositions[row / chunkSize], (chunkPositions[row / chunkSize].y * chunkSize) + (row % chunkSize));
+			}, threads);
+
+			// Step 2
+			for(size_t c = 0; c < chunkPositions.size(); ++c) {
+				size_t total = 0;
+				for(size_t row = c * chunkSize; row < (c + 1) * chunkSize; ++row) {
+					size_t count = rowStart[row];
+					rowStart[row] = total;
+					total += count * 4;
+				}
+				chunks[(size_t(chunkPositions[c].x) * chunkCount.y) + chunkPositions[c].y].vertices.resize(total);
+			}
+
+			// Step 3
+			parallelFor(0, rows, [this, &chunkPositions, rowStart](size_t bandBegin, size_t bandEnd) {
+				for(size_t row = bandBegin; row < bandEnd; ++row) {
+					sf::Vector2u chunkPosition = chunkPositions[row / chunkSize];
+					Chunk& chunk = chunks[(size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y];
+					buildRow(chunkPosition, (chunkPosition.y * chunkSize) + (row % chunkSize), chunk.vertices.data() + rowStart[row]);
+				}
+			}, threads);
+
+			for(sf::Vector2u chunkPosition : chunkPositions) {
+				Chunk& chunk = chunks[(size_t(chunkPosition.x) * chunkCount.y) + chunkPosition.y];
+				chunk.dirty = false;
+				if(renderMode == renderVertexBuffer) {
+					// Only grow the GPU buffer, so a chunk which is edited often doesn't reallocate it every time.
+					if(!chunk.buffer)
+						chunk.buffer.reset(new sf::VertexBuffer(sf::PrimitiveType::Quads, sf::VertexBuffer::Static));
+					if(chunk.buffer->getVertexCount() < chunk.vertices.size())
+						chunk.buffer->create(chunk.vertices.size());
+					if(!chunk.vertices.empty())
+						chunk.buffer->update(chunk.vertices.data(), chunk.vertices.size(), 0);
+					chunk.bufferCount = chunk.vertices.size();
+				}
+			}
+		}
+
 		template< typename tileIDType > void World< tileIDType >::render(sf::Vector2f tlScreenPoint, sf::Vector2f brScreenPoint) {
+			frameArena.reset();
 			if((tlScreenPoint.x >= tilemapSize.x) || (tlScreenPoint.y >= tilemapSize.y) || (brScreenPoint.x < 0) || (brScreenPoint.y < 0)) // Abort if out of bounds
 				return;
 			// Fix the boundaries in case it is bigger than the tilemap size:
@@ -198,33 +1026,86 @@ namespace sfte {
 				tlScreenPoint.x = 0;
 			if(tlScreenPoint.y < 0)
 				tlScreenPoint.y = 0;
-			if((tlScreenPoint != lastTlScreenPoint) || (brScreenPoint != lastBrScreenPoint) || redraw) {
-				lastTlScreenPoint = tlScreenPoint;
-				lastBrScreenPoint = brScreenPoint;
-				redraw = false;
-
-				// Calculate geometry data:
-				tilemapVA.clear();
-				for(size_t y = lastTlScreenPoint.y; y <= lastBrScreenPoint.y; ++y) {
-					for(size_t x = lastTlScreenPoint.x; x <= lastBrScreenPoint.x; ++x) {
-						for(char z = occludermap[x][y]; z >= 0; --z) {
-							if(tileProperties->at(tilemap[x][y][z]).render) {
-								float yOffset = tileProperties->at(tilemap[x][y][z]).tcBR.y * bitmask[x][y][z];
-								// Top-left triangle of tile
-								tilemapVA.append(sf::Vertex(sf::Vector2f((x * tileSize.x) + tileSize.x, (y * tileSize.y) 			 ), layerColor[z], sf::Vector2f(tileProperties->at(tilemap[x][y][z]).tcTL.x + tileProperties->at(tilemap[x][y][z]).tcBR.x, tileProperties->at(tilemap[x][y][z]).tcTL.y + 											   yOffset))); // TR
-								tilemapVA.append(sf::Vertex(sf::Vector2f((x * tileSize.x)			  , (y * tileSize.y) 			 ), layerColor[z], sf::Vector2f(tileProperties->at(tilemap[x][y][z]).tcTL.x												 , tileProperties->at(tilemap[x][y][z]).tcTL.y + 											   yOffset))); // TL
-								tilemapVA.append(sf::Vertex(sf::Vector2f((x * tileSize.x)			  , (y * tileSize.y) + tileSize.y), layerColor[z], sf::Vector2f(tileProperties->at(tilemap[x][y][z]).tcTL.x												 , tileProperties->at(tilemap[x][y][z]).tcTL.y + tileProperties->at(tilemap[x][y][z]).tcBR.y + yOffset))); // BL
-								// Bottom-right triangle of tile
-								tilemapVA.append(sf::Vertex(sf::Vector2f((x * tileSize.x) + tileSize.x, (y * tileSize.y) 			 ), layerColor[z], sf::Vector2f(tileProperties->at(tilemap[x][y][z]).tcTL.x + tileProperties->at(tilemap[x][y][z]).tcBR.x, tileProperties->at(tilemap[x][y][z]).tcTL.y + 											   yOffset))); // TR
-								tilemapVA.append(sf::Vertex(sf::Vector2f((x * tileSize.x)			  , (y * tileSize.y) + tileSize.y), layerColor[z], sf::Vector2f(tileProperties->at(tilemap[x][y][z]).tcTL.x												 , tileProperties->at(tilemap[x][y][z]).tcTL.y + tileProperties->at(tilemap[x][y][z]).tcBR.y + yOffset))); // BL
-								tilemapVA.append(sf::Vertex(sf::Vector2f((x * tileSize.x) + tileSize.x, (y * tileSize.y) + tileSize.y), layerColor[z], sf::Vector2f(tileProperties->at(tilemap[x][y][z]).tcTL.x + tileProperties->at(tilemap[x][y][z]).tcBR.x, tileProperties->at(tilemap[x][y][z]).tcTL.y + tileProperties->at(tilemap[x][y][z]).tcBR.y + yOffset))); // BR
-							}
-						}
+
+			sf::Vector2u tlChunk(size_t(tlScreenPoint.x) / chunkSize, size_t(tlScreenPoint.y) / chunkSize),
+						 brChunk(size_t(brScreenPoint.x) / chunkSize, size_t(brScreenPoint.y) / chunkSize);
+			if(streamer)
+				updateStreaming(tlChunk, brChunk); // Install loaded chunks and request the ones around the view. Never waits for the loader.
+
+			// Rebuild the visible chunks which changed since they were last drawn. A single chunk (a typical edit) is
+			// not worth waking up other threads for.
+			rebuildList.clear();
+			for(sf::Vector2u pos(tlChunk.x, tlChunk.y); pos.y <= brChunk.y; ++pos.y) {
+				for(pos.x = tlChunk.x; pos.x <= brChunk.x; ++pos.x) {
+					const Chunk& chunk = chunks[(size_t(pos.x) * chunkCount.y) + pos.y];
+					if(chunk.dirty && chunk.resident)
+						rebuildList.push_back(pos);
+				}
+			}
+			if(!rebuildList.empty())
+				buildChunks(rebuildList, (rebuildList.size() > 1) ? 0 : 1);
+
+			// Draw every visible chunk
+			for(sf::Vector2u pos(tlChunk.x, tlChunk.y); pos.y <= brChunk.y; ++pos.y) {
+				for(pos.x = tlChunk.x; pos.x <= brChunk.x; ++pos.x) {
+					Chunk& chunk = chunks[(size_t(pos.x) * chunkCount.y) + pos.y];
+					if(renderMode == renderVertexBuffer) {
+						if(chunk.bufferCount > 0)
+							currentRenderTarget->draw(*chunk.buffer, 0, chunk.bufferCount, sf::RenderStates(tilemapTexture)); // Draw the chunk's GPU copy
 					}
+					else if(!chunk.vertices.empty())
+						currentRenderTarget->draw(chunk.vertices.data(), chunk.vertices.size(), sf::PrimitiveType::Quads, sf::RenderStates(tilemapTexture)); // Draw the chunk's vertices
 				}
 			}
-			
-			currentRenderTarget->draw(tilemapVA, tilemapTexture); // Draw the vertex array
+		}
+
+		template< typename tileIDType > void World< tileIDType >::redraw() {
+			for(Chunk& chunk : chunks)
+				chunk.dirty = true;
+		}
+
+		template< typename tileIDType > void World< tileIDType >::setRenderMode(RenderMode mode) {
+			if((mode == renderVertexBuffer) && !sf::VertexBuffer::isAvailable())
+				mode = renderVertexArray;
+			if(mode != renderMode) {
+				renderMode = mode;
+				if(renderMode != renderVertexBuffer) {
+					for(Chunk& chunk : chunks) { // Free the GPU copies
+						chunk.buffer.reset();
+						chunk.bufferCount = 0;
+					}
+				}
+				redraw(); // Makes and uploads the GPU copies in vertex buffer mode
+			}
+		}
+
+		template< typename tileIDType > RenderMode World< tileIDType >::getRenderMode() {
+			return renderMode;
+		}
+
+		template< typename tileIDType > void World< tileIDType >::updateTileProperties() {
+			size_t count = tileProperties->size();
+			lookup.render.resize(count);
+			lookup.visibility.resize(count);
+			lookup.connectiveID.resize(count);
+			lookup.texCoords.resize(count * 16 * 4);
+			for(size_t ID = 0; ID < count; ++ID) {
+				const TileProperty& property = (*tileProperties)[ID];
+				lookup.render[ID] = property.render;
+				lookup.visibility[ID] = property.visibility;
+				lookup.connectiveID[ID] = property.connectiveID;
+
+				// Bitmask variants are stacked vertically in the texture atlas, one tile height apart
+				for(size_t mask = 0; mask < 16; ++mask) {
+					sf::Vector2f* texCoords = &lookup.texCoords[((ID * 16) + mask) * 4];
+					float yOffset = property.tcBR.y * mask;
+					texCoords[0] = sf::Vector2f(property.tcTL.x					, property.tcTL.y +					  yOffset); // TL
+					texCoords[1] = sf::Vector2f(property.tcTL.x + property.tcBR.x, property.tcTL.y +					  yOffset); // TR
+					texCoords[2] = sf::Vector2f(property.tcTL.x + property.tcBR.x, property.tcTL.y + property.tcBR.y + yOffset); // BR
+					texCoords[3] = sf::Vector2f(property.tcTL.x					, property.tcTL.y + property.tcBR.y + yOffset); // BL
+				}
+			}
+			redraw();
 		}
 		
 		template< typename tileIDType > void World< tileIDType >::setRenderTarget(sf::RenderTarget* newRenderTarget) {
@@ -243,11 +1124,57 @@ namespace sfte {
 			tilemapTexture(tilemapTexturePointer),
 			layerColor(layerColors),
 			currentRenderTarget(whereToDraw),
-			tilemap(mapSize.x, std::vector< std::vector< tileIDType > >(mapSize.y, std::vector< tileIDType >(mapSize.z, defaultID))),
-			occludermap(mapSize.x, std::vector < char >(mapSize.y)),
-			bitmask(mapSize.x, std::vector< std::vector< unsigned char > >(mapSize.y, std::vector< unsigned char >(mapSize.z, 0))),
-			tilemapVA(sf::PrimitiveType::Triangles)
-		{}
+			defaultID(defaultID),
+			chunkCount((mapSize.x + chunkSize - 1) / chunkSize, (mapSize.y + chunkSize - 1) / chunkSize),
+			chunks(size_t(chunkCount.x) * chunkCount.y)
+		{
+			if(tilemapSize.z > maxLayers)
+				throw std::out_of_range("World has more layers than occluder entries can hold! z = " + std::to_string(tilemapSize.z));
+
+			// Chunks on the right and bottom edges are padded to the full chunk size, so every chunk has the same layout.
+			for(Chunk& chunk : chunks)
+				allocateChunk(chunk);
+
+			updateTileProperties();
+			if(size_t(defaultID) >= lookup.render.size())
+				throw std::out_of_range("Default tile ID has no entry in the tile properties table! ID = " + std::to_string(size_t(defaultID)));
+		}
+
+		template< typename tileIDType > World< tileIDType >::World(std::vector< TileProperty >* tilePropertiesPointer, const WorldFile* file, size_t memoryBudget, sf::Vector2u tileSizeInPixels, sf::Texture* tilemapTexturePointer, std::vector < sf::Color > layerColors, sf::RenderTarget* whereToDraw) :
+			tileProperties(tilePropertiesPointer),
+			tilemapSize(file->getTilemapSize()),
+			tilemapLimits(tilemapSize.x - 1, tilemapSize.y - 1, tilemapSize.z - 1),
+			tileSize(tileSizeInPixels),
+			tilemapTexture(tilemapTexturePointer),
+			layerColor(layerColors),
+			currentRenderTarget(whereToDraw),
+			defaultID(0),
+			chunkCount((tilemapSize.x + chunkSize - 1) / chunkSize, (tilemapSize.y + chunkSize - 1) / chunkSize),
+			chunks(size_t(chunkCount.x) * chunkCount.y),
+			streamer(new Streamer)
+		{
+			// No chunk is resident until render asks for it.
+			if(tilemapSize.z > maxLayers)
+				throw std::out_of_range("World file has more layers than occluder entries can hold! z = " + std::to_string(tilemapSize.z));
+			checkFile(*file);
+			updateTileProperties();
+			if(lookup.render.empty())
+				throw std::out_of_range("Default tile ID has no entry in the tile properties table! ID = 0");
+			streamer->file = file;
+			streamer->memoryBudget = memoryBudget;
+			streamer->loader = std::thread(&World::loaderThread, this);
+		}
+
+		template< typename tileIDType > World< tileIDType >::~World() {
+			if(streamer) {
+				{
+					std::lock_guard< std::mutex > lock(streamer->mutex);
+					streamer->quit = true;
+				}
+				streamer->wake.notify_all();
+				streamer->loader.join();
+			}
+		}
 }
 
 #endif
\ No newline at end of file
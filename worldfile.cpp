@@ -0,0 +1,204 @@
+#include "worldfile.hpp"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sfte {
+	// sfte::countTrailingZeros implementation
+		unsigned int countTrailingZeros(std::uint64_t bits) {
+#if defined(__GNUC__)
+			return __builtin_ctzll(bits);
+#elif defined(_MSC_VER) && defined(_M_X64)
+			unsigned long index;
+			_BitScanForward64(&index, bits);
+			return index;
+#else
+			unsigned int count = 0;
+			for(; (bits & 1) == 0; bits >>= 1)
+				++count;
+			return count;
+#endif
+		}
+
+	// sfte::littleEndianHost implementation
+		bool littleEndianHost() {
+			const std::uint16_t one = 1;
+			unsigned char first;
+			std::memcpy(&first, &one, 1);
+			return first == 1;
+		}
+
+	// sfte::WorldFile implementation
+		void WorldFile::close() {
+#ifdef _WIN32
+			if(data)
+				UnmapViewOfFile(data);
+			if(mappingHandle)
+				CloseHandle(mappingHandle);
+			if(fileHandle)
+				CloseHandle(fileHandle);
+#else
+			if(data)
+				munmap(const_cast< unsigned char* >(data), dataSize);
+			if(fileHandle)
+				::close(int(reinterpret_cast< intptr_t >(fileHandle)) - 1);
+#endif
+			data = nullptr;
+			fileHandle = mappingHandle = nullptr;
+		}
+
+		const WorldFileHeader& WorldFile::getHeader() const {
+			return header;
+		}
+
+		sf::Vector3u WorldFile::getTilemapSize() const {
+			return sf::Vector3u(header.size[0], header.size[1], header.size[2]);
+		}
+
+		size_t WorldFile::getChunkCount() const {
+			return size_t(header.chunkCount[0]) * header.chunkCount[1];
+		}
+
+		bool WorldFile::hasBitmask() const {
+			return header.flags & worldFileBitmask;
+		}
+
+		bool WorldFile::hasOccluders() const {
+			return header.flags & worldFileOccluders;
+		}
+
+		ChunkEncoding WorldFile::getChunkEncoding(size_t chunk) const {
+			if(chunk >= getChunkCount())
+				throw std::out_of_range("World file chunk out of range! chunk = " + std::to_string(chunk));
+			return ChunkEncoding(table[chunk].encoding);
+		}
+
+		const unsigned char* WorldFile::getChunkTiles(size_t chunk, size_t& tileBytes) const {
+			if(chunk >= getChunkCount())
+				throw std::out_of_range("World file chunk out of range! chunk = " + std::to_string(chunk));
+			tileBytes = table[chunk].tileBytes;
+			return data + table[chunk].offset;
+		}
+
+		const unsigned char* WorldFile::getChunkBitmask(size_t chunk) const {
+			if(chunk >= getChunkCount())
+				throw std::out_of_range("World file chunk out of range! chunk = " + std::to_string(chunk));
+			if(!hasBitmask())
+				return nullptr;
+			return data + table[chunk].offset + table[chunk].tileBytes;
+		}
+
+		const unsigned char* WorldFile::getChunkOccluders(size_t chunk) const {
+			if(chunk >= getChunkCount())
+				throw std::out_of_range("World file chunk out of range! chunk = " + std::to_string(chunk));
+			if(!hasOccluders())
+				return nullptr;
+			size_t bitmaskBytes = hasBitmask() ? size_t(header.chunkSize) * header.chunkSize * header.size[2] : 0;
+			return data + table[chunk].offset + table[chunk].tileBytes + bitmaskBytes;
+		}
+
+		void WorldFile::storeHeader(const WorldFileHeader& fileHeader, unsigned char* out) {
+			std::memcpy(out, fileHeader.magic, 4);
+			const std::uint32_t fields[9] = { fileHeader.version, fileHeader.tileIDSize, fileHeader.flags, fileHeader.size[0], fileHeader.size[1], fileHeader.size[2],
+											  fileHeader.chunkSize, fileHeader.chunkCount[0], fileHeader.chunkCount[1] };
+			for(size_t field = 0; field < 9; ++field)
+				storeLittleEndian(fields[field], out + 4 + (field * 4));
+		}
+
+		void WorldFile::storeChunkEntry(const WorldFileChunk& entry, unsigned char* out) {
+			storeLittleEndian(entry.offset, out);
+			storeLittleEndian(entry.tileBytes, out + 8);
+			out[12] = entry.encoding;
+			std::memset(out + 13, 0, 3);
+		}
+
+		WorldFile::WorldFile(const std::string& path) {
+			// Map the whole file read only. Pages are only read from disk when a chunk touches them.
+#ifdef _WIN32
+			HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+			if(file == INVALID_HANDLE_VALUE)
+				throw std::runtime_error("Couldn't open world file! path = " + path);
+			fileHandle = file;
+			LARGE_INTEGER fileSize;
+			if(!GetFileSizeEx(file, &fileSize)) {
+				close();
+				throw std::runtime_error("Couldn't get world file size! path = " + path);
+			}
+			dataSize = size_t(fileSize.QuadPart);
+			if(dataSize >= headerBytes) {
+				mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if(mappingHandle)
+					data = static_cast< const unsigned char* >(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+			}
+#else
+			int file = open(path.c_str(), O_RDONLY);
+			if(file < 0)
+				throw std::runtime_error("Couldn't open world file! path = " + path);
+			fileHandle = reinterpret_cast< void* >(intptr_t(file) + 1); // + 1 so that descriptor 0 isn't stored as nullptr
+			struct stat fileStat;
+			if(fstat(file, &fileStat) != 0) {
+				close();
+				throw std::runtime_error("Couldn't get world file size! path = " + path);
+			}
+			dataSize = size_t(fileStat.st_size);
+			if(dataSize >= headerBytes) {
+				void* mapping = mmap(nullptr, dataSize, PROT_READ, MAP_SHARED, file, 0);
+				if(mapping != MAP_FAILED) {
+					data = static_cast< const unsigned char* >(mapping);
+					madvise(mapping, dataSize, MADV_RANDOM); // Chunks are read in whatever order the camera needs them
+				}
+			}
+#endif
+			if(!data) {
+				close();
+				throw std::runtime_error("Couldn't map world file! path = " + path);
+			}
+
+			// Validate the header and the chunk table once, so that chunk access only needs a range check
+			std::memcpy(header.magic, data, 4);
+			std::uint32_t* fields[9] = { &header.version, &header.tileIDSize, &header.flags, &header.size[0], &header.size[1], &header.size[2],
+										 &header.chunkSize, &header.chunkCount[0], &header.chunkCount[1] };
+			for(size_t field = 0; field < 9; ++field)
+				*fields[field] = loadLittleEndian< std::uint32_t >(data + 4 + (field * 4));
+			if(std::memcmp(header.magic, "SFTW", 4) != 0) {
+				close();
+				throw std::runtime_error("Not a world file! path = " + path);
+			}
+			if(header.version != version) {
+				close();
+				throw std::runtime_error("Unsupported world file version! version = " + std::to_string(header.version));
+			}
+			size_t chunkVolume = size_t(header.chunkSize) * header.chunkSize * header.size[2],
+				   planeBytes = (hasBitmask() ? chunkVolume : 0) + (hasOccluders() ? size_t(header.chunkSize) * header.chunkSize : 0);
+			if((header.chunkSize == 0) || (header.size[2] == 0) || (header.chunkCount[0] != (header.size[0] + header.chunkSize - 1) / header.chunkSize) || (header.chunkCount[1] != (header.size[1] + header.chunkSize - 1) / header.chunkSize) ||
+			   (headerBytes + (getChunkCount() * chunkEntryBytes) > dataSize)) {
+				close();
+				throw std::runtime_error("Corrupt world file header! path = " + path);
+			}
+			table.resize(getChunkCount());
+			for(size_t chunk = 0; chunk < getChunkCount(); ++chunk) {
+				const unsigned char* entry = data + headerBytes + (chunk * chunkEntryBytes);
+				table[chunk].offset = loadLittleEndian< std::uint64_t >(entry);
+				table[chunk].tileBytes = loadLittleEndian< std::uint32_t >(entry + 8);
+				table[chunk].encoding = entry[12];
+				if((table[chunk].offset > dataSize) || (table[chunk].tileBytes + planeBytes > dataSize - table[chunk].offset) || (table[chunk].encoding > encodingPalette)) {
+					close();
+					throw std::runtime_error("Corrupt world file chunk table! chunk = " + std::to_string(chunk));
+				}
+			}
+		}
+
+		WorldFile::~WorldFile() {
+			close();
+		}
+}
\ No newline at end of file
@@ -0,0 +1,264 @@
+#ifndef SFTE_WORLDFILE_HPP
+#define SFTE_WORLDFILE_HPP
+
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include "core.hpp"
+
+/*/////////////////////////////
+	SFTE world file format (version 1)
+	All values are little-endian, whatever the host. Tile IDs are too, in every encoding.
+
+	Header:
+		char	 magic[4]		"SFTW"
+		uint32	 version
+		uint32	 tileIDSize		sizeof(tileIDType) of the world which saved the file
+		uint32	 flags			WorldFileFlags
+		uint32	 size[3]		Tilemap size (x, y, z)
+		uint32	 chunkSize		Width and height of a chunk in columns
+		uint32	 chunkCount[2]	Number of chunks in x and y
+	Chunk table, one entry per chunk (x major, like World's chunk order):
+		uint64	 offset			Where the chunk's data starts
+		uint32	 tileBytes		Size of the encoded tiles
+		uint8	 encoding		ChunkEncoding of the tiles
+		uint8	 padding[3]
+	Chunk data:
+		tiles	 (tileBytes)	chunkSize * chunkSize columns, x outermost and z innermost, encoded
+		bitmask	 (optional)		chunkSize * chunkSize * z bytes, same layout as the tiles
+		occluder (optional)		chunkSize * chunkSize bytes
+
+/////////////////////////////*/
+
+namespace sfte {
+	enum WorldFileFlags {
+		worldFileBitmask = 1,	// The file has a precomputed bitmask plane for each chunk.
+		worldFileOccluders = 2	// The file has a precomputed occluder plane for each chunk.
+	};
+
+	enum ChunkEncoding {
+		encodingRaw,		// Tiles stored as they are in memory. Can be read straight from the mapped file.
+		encodingRunLength,	// Runs of (uint16 length, tile ID). Only for tileIDSize <= 2.
+		encodingPalette		// uint16 palette size, palette of tile IDs, uint8 bits per index (1, 2, 4 or 8), packed indices. Only for tileIDSize <= 2.
+	};
+
+	struct WorldFileHeader {
+		char magic[4];
+		std::uint32_t version,
+					  tileIDSize,
+					  flags,
+					  size[3],
+					  chunkSize,
+					  chunkCount[2];
+	};
+
+	struct WorldFileChunk {
+		std::uint64_t offset;
+		std::uint32_t tileBytes;
+		std::uint8_t encoding,
+					 padding[3];
+	};
+
+	class WorldFile { // A world file mapped into memory. Chunks are only read from disk when they are first accessed.
+		const unsigned char* data = nullptr;	// Start of the mapping.
+		size_t dataSize = 0;					// Size of the mapping.
+		void* fileHandle = nullptr;				// Platform handles, needed to unmap the file.
+		void* mappingHandle = nullptr;
+		WorldFileHeader header;
+		std::vector< WorldFileChunk > table;	// Chunk table, read from the mapping once, as it may not be in the host's byte order.
+
+		void close();
+	public:
+		static const std::uint32_t version = 1;
+		static const size_t headerBytes = 40,	// Sizes of the header and of a chunk table entry in the file
+							chunkEntryBytes = 16;
+		static void storeHeader(const WorldFileHeader& fileHeader, unsigned char* out); // In the file's layout, for writing it
+		static void storeChunkEntry(const WorldFileChunk& entry, unsigned char* out);
+
+		const WorldFileHeader& getHeader() const;
+		sf::Vector3u getTilemapSize() const;
+		size_t getChunkCount() const;
+		bool hasBitmask() const;
+		bool hasOccluders() const;
+
+		// Chunk access. The pointers point inside the mapped file and stay valid while the WorldFile exists.
+		ChunkEncoding getChunkEncoding(size_t chunk) const;
+		const unsigned char* getChunkTiles(size_t chunk, size_t& tileBytes) const;
+		const unsigned char* getChunkBitmask(size_t chunk) const;	// nullptr if the file has no bitmask plane
+		const unsigned char* getChunkOccluders(size_t chunk) const;	// nullptr if the file has no occluder plane
+		template< typename tileIDType > void decodeChunkTiles(size_t chunk, tileIDType* out) const; // Decode any encoding into chunkSize * chunkSize * z tiles
+
+		WorldFile(const std::string& path);
+		WorldFile(const WorldFile&) = delete;
+		WorldFile& operator=(const WorldFile&) = delete;
+		~WorldFile();
+	};
+
+	unsigned int countTrailingZeros(std::uint64_t bits); // bits must not be 0
+
+	// Unsigned integers in world files are little-endian. These read and write one whatever the host's byte order, and compile to
+	// a plain load or store on little-endian hosts.
+	template< typename T > T loadLittleEndian(const unsigned char* in);
+	template< typename T > void storeLittleEndian(T value, unsigned char* out);
+	bool littleEndianHost(); // Whether tiles are laid out in memory like in the file, so they can be copied as they are
+
+	// Encode count tiles with the smallest encoding available for tileIDType. Returns the encoding used.
+	template< typename tileIDType > ChunkEncoding encodeChunkTiles(const tileIDType* tiles, size_t count, std::vector< unsigned char >& out);
+
+	/* sfte::loadLittleEndian and sfte::storeLittleEndian implementation. Have to be in the header for the same reason in world.hpp */
+		template< typename T > T loadLittleEndian(const unsigned char* in) {
+			T value = 0;
+			for(size_t byte = 0; byte < sizeof(T); ++byte)
+				value = T(value | (T(in[byte]) << (byte * 8)));
+			return value;
+		}
+
+		template< typename T > void storeLittleEndian(T value, unsigned char* out) {
+			for(size_t byte = 0; byte < sizeof(T); ++byte)
+				out[byte] = (unsigned char)(value >> (byte * 8));
+		}
+
+	/* sfte::WorldFile template implementation. Has to be in the header for the same reason in world.hpp */
+		template< typename tileIDType > void WorldFile::decodeChunkTiles(size_t chunk, tileIDType* out) const {
+			if(header.tileIDSize != sizeof(tileIDType))
+				throw std::runtime_error("World file tile ID size doesn't match! File: " + std::to_string(header.tileIDSize) + ", world: " + std::to_string(sizeof(tileIDType)));
+
+			size_t tileBytes,
+				   count = size_t(header.chunkSize) * header.chunkSize * header.size[2];
+			const unsigned char* in = getChunkTiles(chunk, tileBytes);
+			const unsigned char* end = in + tileBytes;
+
+			switch(getChunkEncoding(chunk)) {
+			case encodingRaw:
+				if(tileBytes != count * sizeof(tileIDType))
+					throw std::runtime_error("Corrupt raw chunk in world file! chunk = " + std::to_string(chunk));
+				if(littleEndianHost())
+					std::memcpy(out, in, tileBytes);
+				else {
+					for(size_t n = 0; n < count; ++n)
+						out[n] = loadLittleEndian< tileIDType >(in + (n * sizeof(tileIDType)));
+				}
+				break;
+			case encodingRunLength:
+				for(size_t n = 0; n < count;) {
+					std::uint16_t length;
+					tileIDType ID;
+					if(in + sizeof(length) + sizeof(ID) > end)
+						throw std::runtime_error("Corrupt run-length chunk in world file! chunk = " + std::to_string(chunk));
+					length = loadLittleEndian< std::uint16_t >(in);
+					ID = loadLittleEndian< tileIDType >(in + sizeof(length));
+					in += sizeof(length) + sizeof(ID);
+					if(n + length > count)
+						throw std::runtime_error("Corrupt run-length chunk in world file! chunk = " + std::to_string(chunk));
+					std::fill(out + n, out + n + length, ID);
+					n += length;
+				}
+				break;
+			case encodingPalette: {
+				std::uint16_t paletteSize;
+				if(in + sizeof(paletteSize) > end)
+					throw std::runtime_error("Corrupt palette chunk in world file! chunk = " + std::to_string(chunk));
+				paletteSize = loadLittleEndian< std::uint16_t >(in);
+				in += sizeof(paletteSize);
+				std::vector< tileIDType > palette(paletteSize);
+				if(in + (paletteSize * sizeof(tileIDType)) + 1 > end)
+					throw std::runtime_error("Corrupt palette chunk in world file! chunk = " + std::to_string(chunk));
+				for(size_t entry = 0; entry < paletteSize; ++entry)
+					palette[entry] = loadLittleEndian< tileIDType >(in + (entry * sizeof(tileIDType)));
+				in += paletteSize * sizeof(tileIDType);
+				unsigned int bits = *in++;
+				if((bits != 1) && (bits != 2) && (bits != 4) && (bits != 8))
+					throw std::runtime_error("Corrupt palette chunk in world file! chunk = " + std::to_string(chunk));
+				unsigned int perByte = 8 / bits,
+							 perByteShift = (bits == 1) ? 3 : (bits == 2) ? 2 : (bits == 4) ? 1 : 0, // log2(perByte)
+							 indexMask = (1 << bits) - 1;
+				if((in + ((count + perByte - 1) / perByte) > end) || (paletteSize == 0) || (paletteSize > (1u << bits)))
+					throw std::runtime_error("Corrupt palette chunk in world file! chunk = " + std::to_string(chunk));
+				palette.resize(size_t(1) << bits, palette[0]); // Indices past the palette only come from corrupt files; this keeps them in bounds without a check per tile
+				for(size_t n = 0; n < count; ++n)
+					out[n] = palette[(in[n >> perByteShift] >> ((n & (perByte - 1)) * bits)) & indexMask];
+				break;
+			}
+			default:
+				throw std::runtime_error("Unknown chunk encoding in world file! chunk = " + std::to_string(chunk));
+			}
+		}
+
+		template< typename tileIDType > ChunkEncoding encodeChunkTiles(const tileIDType* tiles, size_t count, std::vector< unsigned char >& out) {
+			static_assert(std::is_integral< tileIDType >::value && std::is_unsigned< tileIDType >::value, "Tile IDs must be an unsigned integer type"); // They index the palette tables below
+			out.resize(count * sizeof(tileIDType));
+			if(littleEndianHost())
+				std::memcpy(out.data(), tiles, out.size());
+			else {
+				for(size_t n = 0; n < count; ++n)
+					storeLittleEndian(tiles[n], &out[n * sizeof(tileIDType)]);
+			}
+			if(sizeof(tileIDType) > 2)
+				return encodingRaw;
+
+			// Run-length. Given up on as soon as it gets as big as the raw tiles.
+			std::vector< unsigned char > runLength(out.size());
+			size_t runBytes = 0;
+			for(size_t n = 0; n < count;) {
+				std::uint16_t length = 1;
+				while((n + length < count) && (length < 0xFFFF) && (tiles[n + length] == tiles[n]))
+					++length;
+				if(runBytes + sizeof(length) + sizeof(tileIDType) >= runLength.size()) {
+					runBytes = runLength.size();
+					break;
+				}
+				storeLittleEndian(length, &runLength[runBytes]);
+				storeLittleEndian(tiles[n], &runLength[runBytes + sizeof(length)]);
+				runBytes += sizeof(length) + sizeof(tileIDType);
+				n += length;
+			}
+			runLength.resize(runBytes);
+
+			// Palette. Tile IDs are at most 16 bits here, so the IDs present are found with a bitset, which also gives the palette in order.
+			// Indices are packed LSB first; a palette of more than 256 IDs isn't worth it.
+			size_t IDCount = size_t(1) << (sizeof(tileIDType) <= 2 ? 8 * sizeof(tileIDType) : 0);
+			std::vector< std::uint64_t > present((IDCount + 63) / 64, 0);
+			for(size_t n = 0; n < count; ++n)
+				present[size_t(tiles[n]) / 64] |= std::uint64_t(1) << (size_t(tiles[n]) % 64);
+			std::vector< tileIDType > palette;
+			std::unique_ptr< unsigned char[] > paletteIndex(new unsigned char[IDCount]); // Only read for IDs in the palette, so it is left uninitialised
+			for(size_t word = 0; (word < present.size()) && (palette.size() <= 256); ++word) {
+				for(std::uint64_t bits = present[word]; bits != 0; bits &= bits - 1) {
+					size_t ID = (word * 64) + countTrailingZeros(bits);
+					paletteIndex[ID] = palette.size();
+					palette.push_back(tileIDType(ID));
+				}
+			}
+			std::vector< unsigned char > packed;
+			if(palette.size() <= 256) {
+				unsigned int bits = (palette.size() <= 2) ? 1 : (palette.size() <= 4) ? 2 : (palette.size() <= 16) ? 4 : 8,
+							 perByte = 8 / bits,
+							 perByteShift = (bits == 1) ? 3 : (bits == 2) ? 2 : (bits == 4) ? 1 : 0; // log2(perByte)
+				packed.resize(sizeof(std::uint16_t) + (palette.size() * sizeof(tileIDType)));
+				storeLittleEndian(std::uint16_t(palette.size()), packed.data());
+				for(size_t entry = 0; entry < palette.size(); ++entry)
+					storeLittleEndian(palette[entry], &packed[sizeof(std::uint16_t) + (entry * sizeof(tileIDType))]);
+				packed.push_back(bits);
+				size_t indices = packed.size();
+				packed.resize(indices + ((count + perByte - 1) / perByte), 0);
+				for(size_t n = 0; n < count; ++n)
+					packed[indices + (n >> perByteShift)] |= paletteIndex[size_t(tiles[n])] << ((n & (perByte - 1)) * bits);
+			}
+
+			ChunkEncoding encoding = encodingRaw;
+			if(runLength.size() < out.size()) {
+				out.swap(runLength);
+				encoding = encodingRunLength;
+			}
+			if(!packed.empty() && (packed.size() < out.size())) {
+				out.swap(packed);
+				encoding = encodingPalette;
+			}
+			return encoding;
+		}
+}
+
+#endif
\ No newline at end of file